@@ -0,0 +1,83 @@
+/*  Arduino core shim for host (Linux) builds
+
+    Provides the part of the Arduino API used by the zForce library,
+    SensorHelper and the firmware sketch: digital pins, external interrupts,
+    millis/micros, Serial and String. Pin levels and the I2C bus are driven
+    by the simulated devices declared in HostArduino.h.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "WString.h"
+#include "Print.h"
+
+#ifndef ARDUINO
+#define ARDUINO 10810
+#endif
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define NUM_DIGITAL_PINS 32
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) < NUM_DIGITAL_PINS ? (p) : NOT_AN_INTERRUPT)
+
+// Data ready line of the zForce sensor, as on the neonode prototype board.
+#ifndef PIN_NN_DR
+#define PIN_NN_DR 2
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef void (*voidFuncPtr)(void);
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+void attachInterrupt(uint32_t pin, voidFuncPtr callback, uint32_t mode);
+void detachInterrupt(uint32_t pin);
+void interrupts();
+void noInterrupts();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int availableForWrite() override;
+    void flush() override;
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+void setup();
+void loop();
+
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega8__) || defined(__AVR_ATmega328P__) || defined(__AVR_ATmega128__)
+#include "HostTwi.h"
+#endif
@@ -0,0 +1,303 @@
+#include "Arduino.h"
+#include "HostArduino.h"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace
+{
+struct PinState
+{
+    uint8_t mode;
+    int level;
+    bool driven;
+    voidFuncPtr isr;
+    uint32_t isrMode;
+    bool pending;
+};
+
+PinState pins[NUM_DIGITAL_PINS];
+std::vector<I2cDevice *> devices;
+// Function local, as peripheral models register from static constructors.
+std::vector<HostArduino::Ticker> &tickers()
+{
+    static std::vector<HostArduino::Ticker> list;
+    return list;
+}
+std::deque<uint8_t> serialRx;
+unsigned long serialBaud = 115200;
+size_t serialTxSize = 0;            // 0: no UART model
+unsigned long long serialTxEnd = 0; // simulated time the last queued byte is out
+HostArduino::SerialStats serialTx;
+
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+unsigned long long simulatedMicros = 0;
+
+bool interruptsOn = true;
+bool inService = false;
+bool stopRequested = false;
+
+bool validPin(uint32_t pin) { return pin < NUM_DIGITAL_PINS; }
+
+void pollStdin()
+{
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    while (poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN))
+    {
+        uint8_t buf[64];
+        ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        serialRx.insert(serialRx.end(), buf, buf + n);
+    }
+}
+} // namespace
+
+unsigned long micros()
+{
+    unsigned long long real = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - startTime)
+                                  .count();
+    return (unsigned long)(real + simulatedMicros);
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void delayMicroseconds(unsigned int us)
+{
+    unsigned long start = micros();
+    while (micros() - start < us)
+        ;
+}
+
+void delay(unsigned long ms)
+{
+    unsigned long start = millis();
+    while (millis() - start < ms)
+    {
+        HostArduino::service();
+        usleep(100);
+    }
+}
+
+void yield() { HostArduino::service(); }
+
+void pinMode(uint32_t pin, uint32_t mode)
+{
+    if (!validPin(pin))
+        return;
+    pins[pin].mode = (uint8_t)mode;
+    if (!pins[pin].driven && mode != OUTPUT)
+        pins[pin].level = mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+void digitalWrite(uint32_t pin, uint32_t value)
+{
+    if (!validPin(pin) || pins[pin].driven)
+        return;
+    pins[pin].level = value ? HIGH : LOW;
+}
+
+int digitalRead(uint32_t pin)
+{
+    HostArduino::service();
+    if (!validPin(pin))
+        return LOW;
+    return pins[pin].level;
+}
+
+void attachInterrupt(uint32_t pin, voidFuncPtr callback, uint32_t mode)
+{
+    if (!validPin(pin))
+        return;
+    pins[pin].isr = callback;
+    pins[pin].isrMode = mode;
+    pins[pin].pending = false;
+}
+
+void detachInterrupt(uint32_t pin)
+{
+    if (!validPin(pin))
+        return;
+    pins[pin].isr = nullptr;
+    pins[pin].pending = false;
+}
+
+void interrupts() { interruptsOn = true; }
+
+void noInterrupts() { interruptsOn = false; }
+
+HardwareSerial Serial;
+
+int HardwareSerial::available()
+{
+    HostArduino::service();
+    pollStdin();
+    return (int)serialRx.size();
+}
+
+int HardwareSerial::read()
+{
+    pollStdin();
+    if (serialRx.empty())
+        return -1;
+    uint8_t c = serialRx.front();
+    serialRx.pop_front();
+    return c;
+}
+
+int HardwareSerial::peek()
+{
+    pollStdin();
+    return serialRx.empty() ? -1 : serialRx.front();
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    if (baud > 0)
+        serialBaud = baud;
+}
+
+// Ten bits per byte: start, 8 data bits and stop.
+static unsigned long long serialByteMicros() { return 10000000ULL / serialBaud; }
+
+static size_t serialTxLevel()
+{
+    unsigned long long now = micros();
+    if (serialTxEnd <= now)
+        return 0;
+    return (size_t)((serialTxEnd - now + serialByteMicros() - 1) / serialByteMicros());
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    serialTx.bytes += size;
+    if (serialTxSize == 0)
+        return fwrite(buffer, 1, size, stdout);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        // Like the core's write(), spin until the interrupt has sent a byte.
+        if (serialTxLevel() >= serialTxSize)
+        {
+            unsigned long wait = (unsigned long)(serialTxEnd - micros()) - (serialTxSize - 1) * serialByteMicros();
+            HostArduino::advanceMicros(wait);
+            serialTx.blockedMicros += wait;
+            HostArduino::service();
+        }
+        unsigned long long now = micros();
+        serialTxEnd = (serialTxEnd > now ? serialTxEnd : now) + serialByteMicros();
+    }
+    return fwrite(buffer, 1, size, stdout);
+}
+
+int HardwareSerial::availableForWrite()
+{
+    if (serialTxSize == 0)
+        return 256;
+    return (int)(serialTxSize - serialTxLevel());
+}
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+namespace HostArduino
+{
+bool attachDevice(I2cDevice *device)
+{
+    if (device == nullptr || findDevice(device->address) != nullptr)
+        return false;
+    devices.push_back(device);
+    return true;
+}
+
+void detachDevice(I2cDevice *device)
+{
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        if (devices[i] == device)
+        {
+            devices.erase(devices.begin() + i);
+            return;
+        }
+    }
+}
+
+I2cDevice *findDevice(uint8_t address)
+{
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        if (devices[i]->address == address)
+            return devices[i];
+    }
+    return nullptr;
+}
+
+void drivePin(uint32_t pin, int level)
+{
+    if (!validPin(pin))
+        return;
+    PinState &p = pins[pin];
+    int previous = p.level;
+    p.driven = true;
+    p.level = level ? HIGH : LOW;
+    if (p.isr == nullptr || previous == p.level)
+        return;
+    if (p.isrMode == CHANGE || (p.isrMode == RISING && p.level == HIGH) || (p.isrMode == FALLING && p.level == LOW))
+        p.pending = true;
+}
+
+void advanceMicros(unsigned long us) { simulatedMicros += us; }
+
+void service()
+{
+    if (inService)
+        return;
+    inService = true;
+
+    unsigned long now = micros();
+    for (size_t i = 0; i < devices.size(); i++)
+        devices[i]->tick(now);
+
+    // Handlers run with the service guard held, as on a single core MCU an
+    // ISR is never interrupted by the code that it preempted.
+    for (size_t i = 0; i < tickers().size(); i++)
+        tickers()[i](now);
+
+    if (interruptsOn)
+    {
+        for (uint32_t pin = 0; pin < NUM_DIGITAL_PINS; pin++)
+        {
+            if (pins[pin].pending && pins[pin].isr != nullptr)
+            {
+                pins[pin].pending = false;
+                pins[pin].isr();
+            }
+        }
+    }
+
+    inService = false;
+}
+
+void attachTicker(Ticker ticker) { tickers().push_back(ticker); }
+
+bool interruptsEnabled() { return interruptsOn; }
+
+bool finished() { return stopRequested; }
+
+void requestStop() { stopRequested = true; }
+
+void serialInject(const char *data, size_t length)
+{
+    serialRx.insert(serialRx.end(), data, data + length);
+}
+
+void setSerialTxBuffer(size_t size) { serialTxSize = size; }
+
+const SerialStats &serialStats() { return serialTx; }
+} // namespace HostArduino
@@ -0,0 +1,74 @@
+/*  Host side control of the Arduino shim
+
+    The firmware only sees the regular Arduino API. Simulated peripherals
+    and host programs use this interface to drive pins, attach I2C devices
+    and account for bus time on the host clock.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class I2cDevice
+{
+public:
+    I2cDevice(uint8_t address) : address(address) {}
+    virtual ~I2cDevice() {}
+
+    // Called for a master write; returns false to NACK the transfer.
+    virtual bool receive(const uint8_t *data, size_t length) = 0;
+    // Called for a master read; fills exactly length bytes.
+    virtual void transmit(uint8_t *data, size_t length) = 0;
+    // Called from HostArduino::service() to let the device advance in time.
+    virtual void tick(unsigned long nowMicros) { (void)nowMicros; }
+
+    const uint8_t address;
+};
+
+namespace HostArduino
+{
+// Devices are not owned by the bus; they must outlive the program run.
+bool attachDevice(I2cDevice *device);
+void detachDevice(I2cDevice *device);
+I2cDevice *findDevice(uint8_t address);
+
+// Sets the level of an input pin from the outside world, e.g. the sensor's
+// data ready line. Edges are delivered to attached interrupts by service().
+void drivePin(uint32_t pin, int level);
+
+// Accounts for time spent on a simulated bus or peripheral.
+void advanceMicros(unsigned long us);
+
+// Ticks all devices and runs pending interrupt handlers.
+void service();
+
+// Models of on-chip peripherals are ticked from service() too, before the
+// pin interrupts run; they may run their own interrupt handlers from there
+// while interruptsEnabled().
+typedef void (*Ticker)(unsigned long nowMicros);
+void attachTicker(Ticker ticker);
+bool interruptsEnabled();
+
+// Host program lifetime, see HostMain.cpp.
+bool finished();
+void requestStop();
+
+// Number of operator new/delete calls since program start, see HostHeap.cpp.
+unsigned long allocations();
+unsigned long deallocations();
+
+// Injects bytes into the Serial receive buffer, as if sent by the host.
+void serialInject(const char *data, size_t length);
+
+// Models a UART transmit buffer of this many bytes, emptied at the rate set
+// by Serial.begin(); write() then waits for room like on the target. With 0,
+// the default, writes never wait.
+void setSerialTxBuffer(size_t size);
+
+struct SerialStats
+{
+    unsigned long bytes;
+    unsigned long blockedMicros; // spent in write() waiting for room
+};
+const SerialStats &serialStats();
+} // namespace HostArduino
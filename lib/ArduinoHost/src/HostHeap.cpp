@@ -0,0 +1,42 @@
+/*  Counting global allocator for host builds
+
+    Every operator new/delete in the program is counted, so a host run can
+    show how many heap operations the firmware performs in its main loop.
+*/
+#include "HostArduino.h"
+#include <new>
+#include <stdlib.h>
+
+static unsigned long allocationCount = 0;
+static unsigned long deallocationCount = 0;
+
+static void *countedAllocate(size_t size)
+{
+    allocationCount++;
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+static void countedFree(void *p)
+{
+    if (p == nullptr)
+        return;
+    deallocationCount++;
+    free(p);
+}
+
+void *operator new(size_t size) { return countedAllocate(size); }
+void *operator new[](size_t size) { return countedAllocate(size); }
+void operator delete(void *p) noexcept { countedFree(p); }
+void operator delete[](void *p) noexcept { countedFree(p); }
+void operator delete(void *p, size_t) noexcept { countedFree(p); }
+void operator delete[](void *p, size_t) noexcept { countedFree(p); }
+
+namespace HostArduino
+{
+unsigned long allocations() { return allocationCount; }
+
+unsigned long deallocations() { return deallocationCount; }
+} // namespace HostArduino
@@ -0,0 +1,101 @@
+/*  Program entry for host builds
+
+    Runs the sketch's setup() and loop() against a simulated zForce sensor
+    at address 0x50 on PIN_NN_DR. Further sensors are at the next addresses
+    and pins. The run can be shaped with environment variables:
+
+    HOST_RUN_MS          stop after this many milliseconds (default: run forever)
+    ZFORCE_SIM_SENSORS   simulated sensors, up to 4 (default: 1)
+    ZFORCE_SIM_RATE      touch notifications per second (default: 100)
+    ZFORCE_SIM_FINGERS   simultaneous fingers, up to 10 (default: 1)
+    ZFORCE_SIM_STROKE    MOVE frames between DOWN and UP (default: 20)
+    HOST_SERIAL_TX       UART transmit buffer in bytes, emptied at the baud rate
+                         of Serial.begin() (default: 0, output never waits)
+*/
+#include "Arduino.h"
+#include "HostArduino.h"
+#include "SimZforce.h"
+#if ZFORCE_SERCOM_DMA
+#include "HostSercom.h"
+#endif
+#include <stdio.h>
+
+static unsigned long envOr(const char *name, unsigned long fallback)
+{
+    const char *value = getenv(name);
+    if (value == NULL || *value == '\0')
+        return fallback;
+    return strtoul(value, NULL, 0);
+}
+
+#define SIM_MAX_SENSORS 4
+
+SimZforce simSensor(SIM_ZFORCE_ADDRESS, PIN_NN_DR);
+SimZforce moreSimSensors[SIM_MAX_SENSORS - 1] = {
+    SimZforce(SIM_ZFORCE_ADDRESS + 1, PIN_NN_DR + 1),
+    SimZforce(SIM_ZFORCE_ADDRESS + 2, PIN_NN_DR + 2),
+    SimZforce(SIM_ZFORCE_ADDRESS + 3, PIN_NN_DR + 3),
+};
+
+static SimZforce &simSensorAt(unsigned long index)
+{
+    return index == 0 ? simSensor : moreSimSensors[index - 1];
+}
+
+int main()
+{
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+    unsigned long sensors = envOr("ZFORCE_SIM_SENSORS", 1);
+    if (sensors < 1 || sensors > SIM_MAX_SENSORS)
+        sensors = sensors < 1 ? 1 : SIM_MAX_SENSORS;
+    for (unsigned long i = 0; i < sensors; i++)
+    {
+        SimZforce &sensor = simSensorAt(i);
+        sensor.setTouchRate(envOr("ZFORCE_SIM_RATE", 100));
+        sensor.setFingers(envOr("ZFORCE_SIM_FINGERS", 1));
+        sensor.setStrokeLength(envOr("ZFORCE_SIM_STROKE", 20));
+        sensor.begin();
+    }
+
+    HostArduino::setSerialTxBuffer(envOr("HOST_SERIAL_TX", 0));
+    unsigned long runMs = envOr("HOST_RUN_MS", 0);
+    unsigned long start = millis();
+
+    setup();
+    unsigned long setupAllocations = HostArduino::allocations();
+    while (!HostArduino::finished())
+    {
+        loop();
+        HostArduino::service();
+        if (runMs > 0 && millis() - start >= runMs)
+            HostArduino::requestStop();
+    }
+
+    for (unsigned long i = 0; i < sensors; i++)
+    {
+        const SimZforce::Stats &stats = simSensorAt(i).getStats();
+        char name[32] = "sim"; // fits "sim " and the 20 digits of any unsigned long
+        if (sensors > 1)
+            snprintf(name, sizeof(name), "sim %lu", i);
+        fprintf(stderr, "%s: %lu notifications (%lu dropped), %lu requests (%lu rejected), %lu frames read\n",
+                name, stats.notifications, stats.droppedNotifications, stats.requests,
+                stats.rejectedRequests, stats.framesRead);
+    }
+#ifdef HOST_TWI
+    const HostTwi::Stats &twi = HostTwi::getStats();
+    fprintf(stderr, "twi: %lu transactions, %lu bytes, %lu TWCR polls, %lu interrupts, %lu resets\n",
+            twi.transactions, twi.bytes, twi.controlReads, twi.interrupts, twi.resets);
+#endif
+#if ZFORCE_SERCOM_DMA
+    const HostSercom::Stats &sercom = HostSercom::getStats();
+    fprintf(stderr, "sercom: %lu transactions, %lu bytes (%lu by DMA), %lu DMAC interrupts\n",
+            sercom.transactions, sercom.bytes, sercom.dmaBytes, sercom.interrupts);
+#endif
+    const HostArduino::SerialStats &serial = HostArduino::serialStats();
+    fprintf(stderr, "serial: %lu bytes written, %lu us waiting for the transmit buffer\n",
+            serial.bytes, serial.blockedMicros);
+    fprintf(stderr, "heap: %lu allocations in loop()\n", HostArduino::allocations() - setupAllocations);
+    fflush(stdout);
+    return 0;
+}
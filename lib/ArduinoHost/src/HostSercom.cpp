@@ -0,0 +1,408 @@
+#include "Arduino.h"
+#include "SercomDma/SercomRegisters.h"
+
+#if ZFORCE_SERCOM_DMA
+
+#include "HostArduino.h"
+#include "HostSercom.h"
+
+#include <chrono>
+#include <vector>
+
+#define SERCOM_GCLK_HZ 48000000UL
+#define SAMD_CPU_HZ 48000000UL
+#define SERCOM_RESET_BAUD 235 // 100 kHz at SERCOM_GCLK_HZ
+
+// Weak, so builds without the DMA transport linked in still link.
+extern "C" void DMAC_Handler(void) __attribute__((weak));
+
+namespace
+{
+enum Phase
+{
+    IDLE,
+    TRANSMIT,
+    RECEIVE,
+    UNADDRESSED
+};
+
+enum Step
+{
+    NONE,
+    ADDRESS,
+    WRITE,
+    READ_BLOCK // address and all ADDR.LEN bytes, then STOP
+};
+
+typedef struct Channel
+{
+    uint32_t ctrla;
+    uint32_t ctrlb;
+    uint8_t inten;
+    uint8_t intflag;
+} Channel;
+
+uint32_t ctrla = 0;
+uint32_t ctrlb = 0;
+uint32_t baud = SERCOM_RESET_BAUD;
+uint8_t intflag = 0;
+uint32_t status = 0;
+uint32_t addr = 0;
+uint8_t data = 0;
+
+Phase phase = IDLE;
+Step step = NONE;
+unsigned long stepDoneAt = 0;
+bool busHeld = false;
+I2cDevice *device = nullptr;
+std::vector<uint8_t> transmitted;
+
+uint32_t dmaCtrl = 0;
+uint8_t chid = 0;
+Channel channels[ZFORCE_DMA_CHANNELS];
+SercomDmaDescriptor *descriptorBase = nullptr;
+SercomDmaDescriptor *writebackBase = nullptr;
+
+HostSercom::Stats stats;
+bool ticking = false;
+
+unsigned long bitsToMicros(unsigned long bits)
+{
+    unsigned long scl = SERCOM_GCLK_HZ / (10 + 2 * (baud & 0xFF));
+    return (bits * 1000000UL + scl - 1) / scl;
+}
+
+void schedule(Step next, unsigned long bits)
+{
+    step = next;
+    stepDoneAt = micros() + bitsToMicros(bits);
+}
+
+void setBusState(uint32_t state) { status = (status & ~I2CM_STATUS_BUSSTATE) | state; }
+
+void endTransmit()
+{
+    if (phase == TRANSMIT && device != nullptr)
+        device->receive(transmitted.data(), transmitted.size());
+    transmitted.clear();
+}
+
+void stop()
+{
+    endTransmit();
+    phase = IDLE;
+    step = NONE;
+    device = nullptr;
+    intflag &= ~(I2CM_INTFLAG_MB | I2CM_INTFLAG_SB);
+    setBusState(I2CM_STATUS_BUSSTATE_IDLE);
+}
+
+Channel *receiveChannel()
+{
+    if (!(dmaCtrl & DMA_CTRL_DMAENABLE) || descriptorBase == nullptr)
+        return nullptr;
+    for (uint8_t i = 0; i < ZFORCE_DMA_CHANNELS; i++)
+    {
+        Channel &channel = channels[i];
+        if ((channel.ctrla & DMA_CHCTRLA_ENABLE) &&
+            ((channel.ctrlb >> 8) & 0x3F) == ZFORCE_SERCOM_DMA_TRIGGER)
+            return &channel;
+    }
+    return nullptr;
+}
+
+// Moves count received bytes through the descriptor chain of the channel.
+void dmaReceive(Channel *channel, uint8_t count)
+{
+    SercomDmaDescriptor *descriptor = &descriptorBase[channel - channels];
+    uint8_t bytes[256];
+    device->transmit(bytes, count);
+    stats.bytes += count;
+
+    uint8_t moved = 0;
+    while (descriptor != nullptr && (descriptor->btctrl & DMA_BTCTRL_VALID) && moved < count)
+    {
+        uint16_t beats = descriptor->btcnt;
+        if (beats > count - moved)
+            beats = count - moved; // the SERCOM stops requesting after ADDR.LEN bytes
+        uint8_t *destination = (uint8_t *)descriptor->dstaddr;
+        for (uint16_t i = 0; i < beats; i++)
+        {
+            if (descriptor->btctrl & DMA_BTCTRL_DSTINC)
+                destination[(int)i - (int)descriptor->btcnt] = bytes[moved + i];
+            else
+                *destination = bytes[moved + i];
+        }
+        moved += beats;
+        stats.dmaBytes += beats;
+        if (beats < descriptor->btcnt)
+            return; // the channel waits for more requests, as the hardware would
+        bool interrupt = descriptor->btctrl & DMA_BTCTRL_BLOCKACT_INT;
+        if (writebackBase != nullptr)
+            writebackBase[channel - channels] = *descriptor;
+        descriptor = (SercomDmaDescriptor *)descriptor->descaddr;
+        if (descriptor == nullptr)
+            channel->ctrla &= ~DMA_CHCTRLA_ENABLE;
+        if (interrupt)
+            channel->intflag |= DMA_CHINT_TCMPL;
+    }
+}
+
+void completeStep()
+{
+    Step done = step;
+    step = NONE;
+    switch (done)
+    {
+    case ADDRESS:
+    {
+        bool read = addr & 0x01;
+        if (device == nullptr)
+        {
+            status |= I2CM_STATUS_RXNACK;
+            phase = UNADDRESSED;
+            intflag |= I2CM_INTFLAG_MB;
+        }
+        else if (read)
+        {
+            // Reads without ADDR.LENEN are not used by the transport: one byte, then SB.
+            phase = RECEIVE;
+            device->transmit(&data, 1);
+            stats.bytes++;
+            intflag |= I2CM_INTFLAG_SB;
+        }
+        else
+        {
+            phase = TRANSMIT;
+            intflag |= I2CM_INTFLAG_MB;
+        }
+        break;
+    }
+    case WRITE:
+        transmitted.push_back(data);
+        stats.bytes++;
+        intflag |= I2CM_INTFLAG_MB;
+        break;
+    case READ_BLOCK:
+    {
+        uint8_t count = (uint8_t)(addr >> 16);
+        Channel *channel = receiveChannel();
+        if (channel != nullptr)
+        {
+            dmaReceive(channel, count);
+        }
+        else
+        {
+            uint8_t bytes[256];
+            device->transmit(bytes, count);
+            stats.bytes += count;
+            data = bytes[count ? count - 1 : 0];
+        }
+        stop();
+        break;
+    }
+    case NONE:
+        break;
+    }
+}
+
+void update()
+{
+    if (step != NONE && !busHeld && (long)(micros() - stepDoneAt) >= 0)
+        completeStep();
+}
+
+void writeAddress(uint32_t value)
+{
+    addr = value;
+    if (!(ctrla & I2CM_CTRLA_ENABLE))
+        return;
+    endTransmit(); // a repeated start ends a write
+    intflag &= ~(I2CM_INTFLAG_MB | I2CM_INTFLAG_SB);
+    status &= ~I2CM_STATUS_RXNACK;
+    setBusState(3UL << 4); // BUSY
+    stats.transactions++;
+    device = HostArduino::findDevice((value >> 1) & 0x7F);
+    bool read = value & 0x01;
+    uint8_t count = (uint8_t)(value >> 16);
+    if (device != nullptr && read && (value & I2CM_ADDR_LENEN))
+        schedule(READ_BLOCK, 1 + 9 + 9UL * count + 1);
+    else
+        schedule(ADDRESS, 1 + 9);
+}
+
+// The DMAC interrupt is level triggered on the channel flags; one handler call per pass.
+void interrupt()
+{
+    if (ticking || DMAC_Handler == nullptr || !HostArduino::interruptsEnabled())
+        return;
+    for (uint8_t i = 0; i < ZFORCE_DMA_CHANNELS; i++)
+    {
+        if (channels[i].intflag & channels[i].inten)
+        {
+            ticking = true;
+            stats.interrupts++;
+            DMAC_Handler();
+            ticking = false;
+            return;
+        }
+    }
+}
+
+void tick(unsigned long nowMicros)
+{
+    (void)nowMicros;
+    update();
+    interrupt();
+}
+
+struct Registration
+{
+    Registration() { HostArduino::attachTicker(tick); }
+} registration;
+} // namespace
+
+void SercomRegisters::Init() {}
+
+uint32_t SercomRegisters::Read(SercomRegister reg)
+{
+    stats.registerAccesses++;
+    update();
+    interrupt(); // as if taken between two instructions
+    Channel &channel = channels[chid];
+    switch (reg)
+    {
+    case I2CM_CTRLA:
+        return ctrla;
+    case I2CM_CTRLB:
+        return ctrlb;
+    case I2CM_BAUD:
+        return baud;
+    case I2CM_INTFLAG:
+        return intflag;
+    case I2CM_STATUS:
+        return status;
+    case I2CM_SYNCBUSY:
+        return 0;
+    case I2CM_ADDR:
+        return addr;
+    case I2CM_DATA:
+        return data;
+    case DMA_CTRL:
+        return dmaCtrl;
+    case DMA_CHID:
+        return chid;
+    case DMA_CHCTRLA:
+        return channel.ctrla;
+    case DMA_CHCTRLB:
+        return channel.ctrlb;
+    case DMA_CHINTENCLR:
+    case DMA_CHINTENSET:
+        return channel.inten;
+    case DMA_CHINTFLAG:
+        return channel.intflag;
+    }
+    return 0;
+}
+
+void SercomRegisters::Write(SercomRegister reg, uint32_t value)
+{
+    stats.registerAccesses++;
+    update();
+    interrupt(); // as if taken between two instructions
+    Channel &channel = channels[chid];
+    switch (reg)
+    {
+    case I2CM_CTRLA:
+        ctrla = value;
+        if (!(ctrla & I2CM_CTRLA_ENABLE))
+        {
+            transmitted.clear();
+            phase = IDLE;
+            step = NONE;
+            device = nullptr;
+        }
+        break;
+    case I2CM_CTRLB:
+        ctrlb = value & ~I2CM_CTRLB_CMD_STOP;
+        if ((value & I2CM_CTRLB_CMD_STOP) == I2CM_CTRLB_CMD_STOP)
+            stop();
+        break;
+    case I2CM_BAUD:
+        baud = value;
+        break;
+    case I2CM_INTFLAG:
+        intflag &= ~value;
+        break;
+    case I2CM_STATUS:
+        status &= ~(value & (I2CM_STATUS_BUSERR | I2CM_STATUS_ARBLOST | I2CM_STATUS_LENERR));
+        if (value & I2CM_STATUS_BUSSTATE)
+            setBusState(value & I2CM_STATUS_BUSSTATE);
+        break;
+    case I2CM_SYNCBUSY:
+        break;
+    case I2CM_ADDR:
+        writeAddress(value);
+        break;
+    case I2CM_DATA:
+        data = (uint8_t)value;
+        if (phase == TRANSMIT)
+        {
+            intflag &= ~I2CM_INTFLAG_MB;
+            schedule(WRITE, 9);
+        }
+        break;
+    case DMA_CTRL:
+        dmaCtrl = value;
+        break;
+    case DMA_CHID:
+        chid = value % ZFORCE_DMA_CHANNELS;
+        break;
+    case DMA_CHCTRLA:
+        channel.ctrla = value & DMA_CHCTRLA_SWRST ? 0 : value;
+        if (value & DMA_CHCTRLA_SWRST)
+            channel = Channel();
+        break;
+    case DMA_CHCTRLB:
+        channel.ctrlb = value;
+        break;
+    case DMA_CHINTENCLR:
+        channel.inten &= ~value;
+        break;
+    case DMA_CHINTENSET:
+        channel.inten |= value;
+        break;
+    case DMA_CHINTFLAG:
+        channel.intflag &= ~value;
+        break;
+    }
+}
+
+void SercomRegisters::SetDescriptors(SercomDmaDescriptor *base, SercomDmaDescriptor *writeback)
+{
+    descriptorBase = base;
+    writebackBase = writeback;
+}
+
+uintptr_t SercomRegisters::DataRegister() { return (uintptr_t)&data; }
+
+// Host time in cycles of the 48 MHz target; handlers run much faster on the host.
+uint32_t SercomRegisters::Cycles()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    return (uint32_t)(ns * (SAMD_CPU_HZ / 1000000) / 1000);
+}
+
+namespace HostSercom
+{
+const Stats &getStats() { return stats; }
+
+void resetStats() { stats = Stats(); }
+
+void holdBus(bool hold) { busHeld = hold; }
+} // namespace HostSercom
+
+#endif // ZFORCE_SERCOM_DMA
@@ -0,0 +1,36 @@
+/*  Model of the SAMD21 SERCOM I2C master and DMAC for host builds
+
+    Implements the register access layer of the zForce library's DMA
+    transport (lib/zforce/src/SercomDma/SercomRegisters.h) when building
+    with -D ZFORCE_SERCOM_DMA=1, against the devices attached with
+    HostArduino::attachDevice().
+
+    Writing ADDR starts a transaction that completes after its bus time
+    at the SCL rate set by BAUD (48 MHz GCLK). Reads with ADDR.LENEN are
+    moved by the DMAC channel triggered by the SERCOM receive request,
+    following the channel's descriptor chain, and end with an automatic
+    NACK and STOP. Writes are polled through INTFLAG.MB and DATA. The
+    channel's transfer complete interrupt runs DMAC_Handler() from
+    HostArduino::service().
+*/
+#pragma once
+
+#include <stdint.h>
+
+namespace HostSercom
+{
+typedef struct Stats
+{
+    unsigned long registerAccesses; // reads and writes through the register layer
+    unsigned long transactions;     // addressed transfers
+    unsigned long bytes;            // data bytes moved after the address
+    unsigned long dmaBytes;         // of which moved by the DMAC
+    unsigned long interrupts;       // DMAC_Handler invocations
+} Stats;
+
+const Stats &getStats();
+void resetStats();
+
+// While held, no transfer completes, as with SCL stretched by a hung device.
+void holdBus(bool hold);
+} // namespace HostSercom
@@ -0,0 +1,238 @@
+#include "Arduino.h"
+
+#ifdef HOST_TWI
+
+#include "HostArduino.h"
+
+#include <vector>
+
+#define TWI_START 0x08
+#define TWI_REPEATED_START 0x10
+#define TWI_MT_SLA_ACK 0x18
+#define TWI_MT_SLA_NACK 0x20
+#define TWI_MT_DATA_ACK 0x28
+#define TWI_MR_SLA_ACK 0x40
+#define TWI_MR_SLA_NACK 0x48
+#define TWI_MR_DATA_ACK 0x50
+#define TWI_MR_DATA_NACK 0x58
+#define TWI_NO_INFO 0xF8
+
+// Weak, so builds without an interrupt driven TWI driver still link.
+extern "C" void TWI_vect(void) __attribute__((weak));
+
+uint8_t PORTC;
+uint8_t PORTD;
+
+namespace
+{
+enum Phase
+{
+    IDLE,      // bus free
+    ADDRESSING, // START sent, TWDR holds SLA+R/W
+    TRANSMIT,
+    RECEIVE,
+    UNADDRESSED // address NACKed, waiting for STOP or repeated START
+};
+
+enum Step
+{
+    NONE,
+    START,
+    ADDRESS,
+    WRITE,
+    READ,
+    STOP
+};
+
+uint8_t control = 0;
+Phase phase = IDLE;
+Step step = NONE;
+unsigned long stepDoneAt = 0;
+bool stepAck = false;
+bool busHeld = false;
+I2cDevice *device = nullptr;
+std::vector<uint8_t> transmitted;
+HostTwi::Stats stats;
+bool ticking = false;
+
+unsigned long bitsToMicros(unsigned long bits)
+{
+    static const unsigned long prescalers[] = {1, 4, 16, 64};
+    unsigned long divider = 16 + 2UL * HostTwi::twbr * prescalers[HostTwi::twsr & 0x03];
+    unsigned long scl = F_CPU / divider;
+    return (bits * 1000000UL + scl - 1) / scl;
+}
+
+void setStatus(uint8_t status) { HostTwi::twsr = (uint8_t)((HostTwi::twsr & 0x03) | status); }
+
+void endTransmit()
+{
+    if (phase == TRANSMIT && device != nullptr)
+        device->receive(transmitted.data(), transmitted.size());
+    transmitted.clear();
+}
+
+void schedule(Step next, unsigned long bits)
+{
+    step = next;
+    stepDoneAt = micros() + bitsToMicros(bits);
+}
+
+void completeStep()
+{
+    switch (step)
+    {
+    case START:
+        setStatus(phase == IDLE ? TWI_START : TWI_REPEATED_START);
+        phase = ADDRESSING;
+        break;
+    case ADDRESS:
+    {
+        bool read = HostTwi::twdr & 0x01;
+        device = HostArduino::findDevice(HostTwi::twdr >> 1);
+        stats.transactions++;
+        if (device != nullptr)
+        {
+            setStatus(read ? TWI_MR_SLA_ACK : TWI_MT_SLA_ACK);
+            phase = read ? RECEIVE : TRANSMIT;
+        }
+        else
+        {
+            setStatus(read ? TWI_MR_SLA_NACK : TWI_MT_SLA_NACK);
+            phase = UNADDRESSED;
+        }
+        break;
+    }
+    case WRITE:
+        transmitted.push_back(HostTwi::twdr);
+        stats.bytes++;
+        setStatus(TWI_MT_DATA_ACK);
+        break;
+    case READ:
+    {
+        uint8_t value = 0xFF;
+        device->transmit(&value, 1);
+        HostTwi::twdr = value;
+        stats.bytes++;
+        setStatus(stepAck ? TWI_MR_DATA_ACK : TWI_MR_DATA_NACK);
+        break;
+    }
+    case STOP:
+        control &= ~_BV(TWSTO);
+        setStatus(TWI_NO_INFO);
+        step = NONE;
+        return; // a STOP does not set TWINT
+    case NONE:
+        return;
+    }
+    step = NONE;
+    control |= _BV(TWINT);
+}
+
+void update()
+{
+    if (step != NONE && !busHeld && (long)(micros() - stepDoneAt) >= 0)
+        completeStep();
+}
+
+void writeControl(uint8_t value)
+{
+    update();
+
+    if (!(value & _BV(TWEN)))
+    {
+        // Disabling the TWI releases the bus and aborts any transfer.
+        if (phase != IDLE || step != NONE)
+            stats.resets++;
+        control = value & ~_BV(TWINT);
+        phase = IDLE;
+        step = NONE;
+        device = nullptr;
+        transmitted.clear();
+        return;
+    }
+
+    if (!(value & _BV(TWINT)))
+    {
+        // Writing TWINT as zero leaves the flag alone, e.g. to change TWIE.
+        control = (uint8_t)((control & _BV(TWINT)) | (value & ~_BV(TWINT)));
+        return;
+    }
+
+    control = value & ~_BV(TWINT);
+    if (value & _BV(TWSTA))
+    {
+        endTransmit();
+        schedule(START, 1);
+    }
+    else if (value & _BV(TWSTO))
+    {
+        endTransmit();
+        phase = IDLE;
+        device = nullptr;
+        schedule(STOP, 1);
+    }
+    else if (phase == ADDRESSING)
+    {
+        schedule(ADDRESS, 9);
+    }
+    else if (phase == TRANSMIT)
+    {
+        schedule(WRITE, 9);
+    }
+    else if (phase == RECEIVE)
+    {
+        stepAck = value & _BV(TWEA);
+        schedule(READ, 9);
+    }
+}
+
+void tick(unsigned long nowMicros)
+{
+    (void)nowMicros;
+    update();
+    // TWI_vect is level triggered on TWINT; one call per service() pass.
+    if ((control & _BV(TWIE)) && (control & _BV(TWINT)) && (control & _BV(TWEN)) &&
+        HostArduino::interruptsEnabled() && TWI_vect != nullptr && !ticking)
+    {
+        ticking = true;
+        stats.interrupts++;
+        TWI_vect();
+        ticking = false;
+    }
+}
+
+struct Registration
+{
+    Registration() { HostArduino::attachTicker(tick); }
+} registration;
+} // namespace
+
+TwiControlRegister &TwiControlRegister::operator=(uint8_t value)
+{
+    writeControl(value);
+    return *this;
+}
+
+TwiControlRegister::operator uint8_t() const
+{
+    stats.controlReads++;
+    update();
+    return control;
+}
+
+namespace HostTwi
+{
+TwiControlRegister twcr;
+uint8_t twsr = TWI_NO_INFO;
+uint8_t twdr;
+uint8_t twbr;
+
+const Stats &getStats() { return stats; }
+
+void resetStats() { stats = Stats(); }
+
+void holdBus(bool hold) { busHeld = hold; }
+} // namespace HostTwi
+
+#endif // HOST_TWI
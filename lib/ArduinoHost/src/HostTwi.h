@@ -0,0 +1,84 @@
+/*  Register model of the AVR TWI (two wire interface) for host builds
+
+    Included by Arduino.h when building for one of the AVR parts that the
+    zForce library drives through its own I2C class (ATmega328P and
+    friends, e.g. -D __AVR_ATmega328P__), so lib/zforce/src/I2C runs
+    unchanged against the devices attached with
+    HostArduino::attachDevice().
+
+    TWCR, TWSR, TWDR and TWBR behave like the master side of the
+    hardware: writing TWCR with TWINT set starts a START, address, data
+    or STOP step, which completes after its bus time at the SCL rate set
+    by TWBR and the TWSR prescaler, with the matching status code in
+    TWSR. TWINT is set when a step completes; if TWIE is set the
+    ISR(TWI_vect) handler is then run from HostArduino::service().
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define HOST_TWI 1
+
+#ifndef F_CPU
+#define F_CPU 16000000L
+#endif
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+#define _SFR_BYTE(sfr) (sfr)
+
+// TWCR
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+
+// TWSR
+#define TWPS1 1
+#define TWPS0 0
+
+class TwiControlRegister
+{
+public:
+    TwiControlRegister &operator=(uint8_t value);
+    operator uint8_t() const;
+    TwiControlRegister &operator|=(uint8_t value) { return *this = (uint8_t)(*this | value); }
+    TwiControlRegister &operator&=(uint8_t value) { return *this = (uint8_t)(*this & value); }
+};
+
+namespace HostTwi
+{
+extern TwiControlRegister twcr;
+extern uint8_t twsr;
+extern uint8_t twdr;
+extern uint8_t twbr;
+
+typedef struct Stats
+{
+    unsigned long transactions;  // addressed transfers
+    unsigned long bytes;         // data bytes moved after the address
+    unsigned long controlReads;  // TWCR reads, i.e. busy polling
+    unsigned long interrupts;    // TWI_vect invocations
+    unsigned long resets;        // TWCR cleared while a transfer was in progress, e.g. lockUp()
+} Stats;
+
+const Stats &getStats();
+void resetStats();
+
+// While held, no step completes, as with SCL stretched by a hung device.
+void holdBus(bool hold);
+} // namespace HostTwi
+
+#define TWCR HostTwi::twcr
+#define TWSR HostTwi::twsr
+#define TWDR HostTwi::twdr
+#define TWBR HostTwi::twbr
+
+extern uint8_t PORTC;
+extern uint8_t PORTD;
+
+#define ISR(vector) extern "C" void vector(void)
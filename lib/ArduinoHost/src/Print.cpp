@@ -0,0 +1,153 @@
+#include "Print.h"
+#include "Arduino.h"
+#include <math.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        if (write(*buffer++))
+            n++;
+        else
+            break;
+    }
+    return n;
+}
+
+size_t Print::write(const char *str)
+{
+    if (str == NULL)
+        return 0;
+    return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(long n, int base)
+{
+    if (base == 0)
+        return write((uint8_t)n);
+    if (base == 10)
+    {
+        if (n < 0)
+        {
+            size_t t = print('-');
+            return printNumber((unsigned long)-n, 10) + t;
+        }
+        return printNumber((unsigned long)n, 10);
+    }
+    // Match the 32-bit targets for hex/oct/bin output of negative values.
+    return printNumber((uint32_t)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    if (base == 0)
+        return write((uint8_t)n);
+    return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+    return printFloat(n, digits);
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2)
+        base = 10;
+    do
+    {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits)
+{
+    size_t n = 0;
+    if (isnan(number))
+        return print("nan");
+    if (isinf(number))
+        return print("inf");
+    if (number < 0.0)
+    {
+        n += print('-');
+        number = -number;
+    }
+
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i)
+        rounding /= 10.0;
+    number += rounding;
+
+    unsigned long intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    n += print(intPart);
+    if (digits > 0)
+        n += print('.');
+    while (digits-- > 0)
+    {
+        remainder *= 10.0;
+        unsigned int toPrint = (unsigned int)remainder;
+        n += print(toPrint);
+        remainder -= toPrint;
+    }
+    return n;
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - start < timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    String ret;
+    int c = timedRead();
+    while (c >= 0)
+    {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String ret;
+    int c = timedRead();
+    while (c >= 0 && c != terminator)
+    {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
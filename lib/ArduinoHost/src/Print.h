@@ -0,0 +1,74 @@
+/*  Arduino Print and Stream for host builds
+
+    Number formatting follows the Arduino core: integers are printed in the
+    requested base, floating point values with a fixed number of digits and
+    non-decimal output of signed values is shown as the 32-bit two's
+    complement, as it would be on the target.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *ifsh) { return print(reinterpret_cast<const char *>(ifsh)); }
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(const char str[]) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(long long n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned long long n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(double n, int digits = 2);
+
+    size_t println(void) { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+
+private:
+    size_t printNumber(unsigned long n, uint8_t base);
+    size_t printFloat(double number, uint8_t digits);
+};
+
+class Stream : public Print
+{
+public:
+    Stream() : timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long t) { timeout = t; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    int timedRead();
+    unsigned long timeout;
+};
@@ -0,0 +1,376 @@
+#include "SimZforce.h"
+
+#define FRAME_REQUEST 0xEE
+#define FRAME_RESPONSE 0xEF
+#define FRAME_NOTIFICATION 0xF0
+
+#define TAG_ENABLE 0x65
+#define TAG_DEVICE_CONFIGURATION 0x73
+#define TAG_BOOT_COMPLETE 0x63
+#define TAG_TOUCH_NOTIFICATIONS 0xA0
+#define TAG_SUB_TOUCH_ACTIVE_AREA 0xA2
+#define TAG_TOUCH 0x42
+#define TAG_REPORTED_TOUCHES 0x86
+
+// The sensor is assumed to have booted before the MCU, as on the board where
+// setup() first waits for the USB serial port.
+#define SIM_ZFORCE_BOOT_DELAY 0UL
+#define SIM_ZFORCE_RESPONSE_DELAY 500UL
+// Data ready stays low for at least this long between two frames.
+#define SIM_ZFORCE_DR_GAP 20UL
+
+static void append(uint8_t *data, uint8_t &length, uint8_t value)
+{
+    if (length < SIM_ZFORCE_MAX_FRAME)
+        data[length++] = value;
+}
+
+static uint16_t readInteger(const uint8_t *value, uint8_t length)
+{
+    uint16_t result = 0;
+    for (uint8_t i = 0; i < length && i < 2; i++)
+        result = (uint16_t)((result << 8) | value[i]);
+    return result;
+}
+
+SimZforce::SimZforce(uint8_t address, uint32_t dataReadyPin)
+    : I2cDevice(address), dataReadyPin(dataReadyPin), attached(false),
+      head(0), count(0), readOffset(0), frameJustRead(false), lastFrameReadAt(0UL - SIM_ZFORCE_DR_GAP),
+      enabled(false), minX(0), minY(0), maxX(4000), maxY(4000),
+      reverseX(false), reverseY(false), flipXY(false), reportedTouches(2),
+      touchRate(100), fingers(1), strokeLength(20), strokeStep(0),
+      nextTouchAt(0), responseDelay(SIM_ZFORCE_RESPONSE_DELAY), fullConfigurationReplies(false)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SimZforce::begin()
+{
+    if (!attached)
+        attached = HostArduino::attachDevice(this);
+    if (!attached)
+        return false;
+    head = 0;
+    count = 0;
+    readOffset = 0;
+    lastFrameReadAt = micros() - SIM_ZFORCE_DR_GAP;
+    enabled = false;
+    HostArduino::drivePin(dataReadyPin, LOW);
+    queueBootComplete();
+    return true;
+}
+
+void SimZforce::end()
+{
+    if (attached)
+        HostArduino::detachDevice(this);
+    attached = false;
+    HostArduino::drivePin(dataReadyPin, LOW);
+}
+
+SimZforce::Frame *SimZforce::beginFrame(uint8_t type, unsigned long readyAt)
+{
+    if (count >= SIM_ZFORCE_QUEUE_SIZE)
+        return nullptr;
+    Frame *frame = &queue[(head + count) % SIM_ZFORCE_QUEUE_SIZE];
+    frame->readyAt = readyAt;
+    frame->length = 0;
+    append(frame->data, frame->length, type);
+    append(frame->data, frame->length, 0); // I2C length, set by endFrame()
+    append(frame->data, frame->length, type);
+    append(frame->data, frame->length, 0); // BER length, set by endFrame()
+    append(frame->data, frame->length, 0x40);
+    append(frame->data, frame->length, 0x02);
+    append(frame->data, frame->length, type == FRAME_RESPONSE ? 0x02 : 0x00);
+    append(frame->data, frame->length, 0x00);
+    return frame;
+}
+
+void SimZforce::endFrame(Frame *frame)
+{
+    frame->data[1] = frame->length - 2;
+    frame->data[3] = frame->length - 4;
+    count++;
+
+    // Frames go out in the order they become ready, so a notification can
+    // overtake a response that is still being prepared. A frame that is
+    // partly read stays first.
+    uint8_t first = readOffset > 0 ? 1 : 0;
+    for (uint8_t i = count - 1; i > first; i--)
+    {
+        Frame &later = queue[(head + i) % SIM_ZFORCE_QUEUE_SIZE];
+        Frame &earlier = queue[(head + i - 1) % SIM_ZFORCE_QUEUE_SIZE];
+        if ((long)(later.readyAt - earlier.readyAt) >= 0)
+            break;
+        Frame swapped = later;
+        later = earlier;
+        earlier = swapped;
+    }
+}
+
+void SimZforce::queueBootComplete()
+{
+    Frame *frame = beginFrame(FRAME_NOTIFICATION, micros() + SIM_ZFORCE_BOOT_DELAY);
+    if (frame == nullptr)
+        return;
+    append(frame->data, frame->length, TAG_BOOT_COMPLETE);
+    append(frame->data, frame->length, 0x03);
+    append(frame->data, frame->length, 0x82);
+    append(frame->data, frame->length, 0x01);
+    append(frame->data, frame->length, 0x00);
+    endFrame(frame);
+}
+
+void SimZforce::queueTouchNotification()
+{
+    uint8_t touches = fingers < reportedTouches ? fingers : reportedTouches;
+    if (touches == 0)
+        return;
+
+    Frame *frame = beginFrame(FRAME_NOTIFICATION, micros());
+    if (frame == nullptr)
+    {
+        stats.droppedNotifications++;
+        return;
+    }
+
+    uint8_t event = strokeStep == 0 ? 0 : (strokeStep >= strokeLength ? 2 : 1);
+    uint16_t width = maxX > minX ? maxX - minX : 1;
+    uint16_t height = maxY > minY ? maxY - minY : 1;
+
+    append(frame->data, frame->length, TAG_TOUCH_NOTIFICATIONS);
+    append(frame->data, frame->length, touches * 11);
+    for (uint8_t i = 0; i < touches; i++)
+    {
+        uint16_t x = minX + (uint32_t)width * (i + 1) / (touches + 1);
+        uint16_t y = minY + (uint32_t)height * strokeStep / strokeLength;
+        if (reverseX)
+            x = maxX - (x - minX);
+        if (reverseY)
+            y = maxY - (y - minY);
+        if (flipXY)
+        {
+            uint16_t temp = x;
+            x = y;
+            y = temp;
+        }
+        append(frame->data, frame->length, TAG_TOUCH);
+        append(frame->data, frame->length, 0x09);
+        append(frame->data, frame->length, i);
+        append(frame->data, frame->length, event);
+        append(frame->data, frame->length, x >> 8);
+        append(frame->data, frame->length, x & 0xFF);
+        append(frame->data, frame->length, y >> 8);
+        append(frame->data, frame->length, y & 0xFF);
+        append(frame->data, frame->length, 0x00); // size x
+        append(frame->data, frame->length, 0x00); // size y
+        append(frame->data, frame->length, 0x64); // confidence
+    }
+    endFrame(frame);
+    stats.notifications++;
+}
+
+bool SimZforce::receive(const uint8_t *data, size_t length)
+{
+    if (length == 0)
+        return true; // address probe
+    stats.requests++;
+    // EE len EE len 40 02 02 00 <command>
+    if (length < 10 || data[0] != FRAME_REQUEST || data[1] + 2u != length ||
+        data[2] != FRAME_REQUEST || data[3] + 4u != length ||
+        data[4] != 0x40 || data[5] != 0x02)
+    {
+        stats.rejectedRequests++;
+        return true;
+    }
+
+    const uint8_t *command = &data[8];
+    uint8_t commandLength = command[1];
+    if (commandLength + 10u > length)
+    {
+        stats.rejectedRequests++;
+        return true;
+    }
+
+    unsigned long now = micros();
+    switch (command[0])
+    {
+    case TAG_ENABLE:
+        handleEnable(&command[2], commandLength, now);
+        break;
+    case TAG_DEVICE_CONFIGURATION:
+        handleConfiguration(&command[2], commandLength, now);
+        break;
+    default:
+        stats.rejectedRequests++;
+        break;
+    }
+    return true;
+}
+
+void SimZforce::handleEnable(const uint8_t *body, uint8_t length, unsigned long now)
+{
+    if (length < 2)
+    {
+        stats.rejectedRequests++;
+        return;
+    }
+    enabled = body[0] == 0x81;
+    if (enabled)
+    {
+        strokeStep = 0;
+        nextTouchAt = now;
+    }
+
+    Frame *frame = beginFrame(FRAME_RESPONSE, now + responseDelay);
+    if (frame == nullptr)
+        return;
+    append(frame->data, frame->length, TAG_ENABLE);
+    append(frame->data, frame->length, 0x02);
+    append(frame->data, frame->length, enabled ? 0x81 : 0x80);
+    append(frame->data, frame->length, 0x00);
+    endFrame(frame);
+    stats.responses++;
+}
+
+void SimZforce::handleConfiguration(const uint8_t *body, uint8_t length, unsigned long now)
+{
+    // The response always starts with the sub touch active area (empty if
+    // the request did not touch it), followed by the top level settings.
+    uint8_t area[32];
+    uint8_t areaLength = 0;
+    bool reportedTouchesSet = false;
+
+    for (uint8_t i = 0; i + 2u <= length && i + 2u + body[i + 1] <= length; i += 2 + body[i + 1])
+    {
+        uint8_t tag = body[i];
+        uint8_t fieldLength = body[i + 1];
+        const uint8_t *value = &body[i + 2];
+
+        if (tag == TAG_SUB_TOUCH_ACTIVE_AREA)
+        {
+            for (uint8_t j = 0; j + 2u <= fieldLength && j + 2u + value[j + 1] <= fieldLength; j += 2 + value[j + 1])
+            {
+                uint8_t subTag = value[j];
+                uint8_t subLength = value[j + 1];
+                const uint8_t *subValue = &value[j + 2];
+                switch (subTag)
+                {
+                case 0x80: minX = readInteger(subValue, subLength); break;
+                case 0x81: minY = readInteger(subValue, subLength); break;
+                case 0x82: maxX = readInteger(subValue, subLength); break;
+                case 0x83: maxY = readInteger(subValue, subLength); break;
+                case 0x84: reverseX = subLength > 0 && subValue[0] != 0; break;
+                case 0x85: reverseY = subLength > 0 && subValue[0] != 0; break;
+                case 0x86: flipXY = subLength > 0 && subValue[0] != 0; break;
+                default: continue;
+                }
+                for (uint8_t k = 0; k < subLength + 2u && areaLength < sizeof(area); k++)
+                    area[areaLength++] = value[j + k];
+            }
+        }
+        else if (tag == TAG_REPORTED_TOUCHES && fieldLength == 1)
+        {
+            reportedTouches = value[0] > SIM_ZFORCE_MAX_TOUCHES ? SIM_ZFORCE_MAX_TOUCHES : value[0];
+            reportedTouchesSet = true;
+        }
+    }
+
+    if (fullConfigurationReplies)
+    {
+        const uint16_t bounds[] = {minX, minY, maxX, maxY};
+        const bool flags[] = {reverseX, reverseY, flipXY};
+        areaLength = 0;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            append(area, areaLength, 0x80 + i);
+            append(area, areaLength, 0x02);
+            append(area, areaLength, bounds[i] >> 8);
+            append(area, areaLength, bounds[i] & 0xFF);
+        }
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            append(area, areaLength, 0x84 + i);
+            append(area, areaLength, 0x01);
+            append(area, areaLength, flags[i] ? 0xFF : 0x00);
+        }
+        reportedTouchesSet = true;
+    }
+
+    Frame *frame = beginFrame(FRAME_RESPONSE, now + responseDelay);
+    if (frame == nullptr)
+        return;
+    append(frame->data, frame->length, TAG_DEVICE_CONFIGURATION);
+    append(frame->data, frame->length, 2 + areaLength + (reportedTouchesSet ? 3 : 0));
+    append(frame->data, frame->length, TAG_SUB_TOUCH_ACTIVE_AREA);
+    append(frame->data, frame->length, areaLength);
+    for (uint8_t i = 0; i < areaLength; i++)
+        append(frame->data, frame->length, area[i]);
+    if (reportedTouchesSet)
+    {
+        append(frame->data, frame->length, TAG_REPORTED_TOUCHES);
+        append(frame->data, frame->length, 0x01);
+        append(frame->data, frame->length, reportedTouches);
+    }
+    endFrame(frame);
+    stats.responses++;
+}
+
+void SimZforce::transmit(uint8_t *data, size_t length)
+{
+    size_t i = 0;
+    Frame *frame = count > 0 ? &queue[head] : nullptr;
+    if (frame != nullptr && (long)(micros() - frame->readyAt) >= 0)
+    {
+        for (; i < length && readOffset < frame->length; i++)
+            data[i] = frame->data[readOffset++];
+        if (readOffset >= frame->length)
+        {
+            head = (head + 1) % SIM_ZFORCE_QUEUE_SIZE;
+            count--;
+            readOffset = 0;
+            frameJustRead = true;
+            stats.framesRead++;
+        }
+    }
+    // A read without a pending frame, or past its end, returns idle bytes.
+    for (; i < length; i++)
+        data[i] = 0x00;
+
+    updateDataReady(micros());
+}
+
+void SimZforce::tick(unsigned long nowMicros)
+{
+    if (enabled && touchRate > 0)
+    {
+        unsigned long period = 1000000UL / touchRate;
+        if ((long)(nowMicros - nextTouchAt) > (long)(8 * period))
+            nextTouchAt = nowMicros; // host stalled, do not burst the backlog
+        while ((long)(nowMicros - nextTouchAt) >= 0)
+        {
+            // One idle period after each UP separates the strokes.
+            if (strokeStep <= strokeLength)
+                queueTouchNotification();
+            strokeStep = strokeStep > strokeLength ? 0 : strokeStep + 1;
+            nextTouchAt += period;
+        }
+    }
+    updateDataReady(nowMicros);
+}
+
+void SimZforce::updateDataReady(unsigned long now)
+{
+    if (frameJustRead)
+    {
+        // Data ready drops after a frame has been read, even if another
+        // frame is already queued, so every frame produces a rising edge.
+        HostArduino::drivePin(dataReadyPin, LOW);
+        frameJustRead = false;
+        lastFrameReadAt = now;
+        return;
+    }
+    bool ready = count > 0 && (long)(now - queue[head].readyAt) >= 0 &&
+                 (readOffset > 0 || now - lastFrameReadAt >= SIM_ZFORCE_DR_GAP);
+    HostArduino::drivePin(dataReadyPin, ready ? HIGH : LOW);
+}
@@ -0,0 +1,99 @@
+/*  Simulated zForce sensor for host builds
+
+    Behaves like a zForce AIR sensor on the I2C bus: a queued frame raises
+    the data ready pin, the host reads the 2 byte I2C header followed by the
+    BER encoded body, and data ready drops once the frame has been consumed.
+    Enable and device configuration requests (touch active area, reverse X/Y,
+    flip XY and reported touches) are answered with the corresponding
+    response frame. While enabled, touch notifications are generated at a
+    configurable rate for a configurable number of fingers, each finger
+    repeatedly going DOWN, moving for a number of frames and going UP.
+*/
+#pragma once
+
+#include "Arduino.h"
+#include "HostArduino.h"
+
+#define SIM_ZFORCE_ADDRESS 0x50
+#define SIM_ZFORCE_MAX_FRAME (2 + 127)
+#define SIM_ZFORCE_QUEUE_SIZE 16
+#define SIM_ZFORCE_MAX_TOUCHES 10
+
+class SimZforce : public I2cDevice
+{
+public:
+    typedef struct Stats
+    {
+        unsigned long requests;
+        unsigned long rejectedRequests;
+        unsigned long responses;
+        unsigned long notifications;
+        unsigned long droppedNotifications;
+        unsigned long framesRead;
+    } Stats;
+
+    SimZforce(uint8_t address = SIM_ZFORCE_ADDRESS, uint32_t dataReadyPin = PIN_NN_DR);
+
+    // Attaches to the bus and queues the boot complete notification.
+    bool begin();
+    void end();
+
+    void setTouchRate(unsigned int hz) { touchRate = hz; }
+    void setFingers(uint8_t count) { fingers = count > SIM_ZFORCE_MAX_TOUCHES ? SIM_ZFORCE_MAX_TOUCHES : count; }
+    void setStrokeLength(uint16_t frames) { strokeLength = frames < 2 ? 2 : frames; }
+    void setResponseDelay(unsigned long us) { responseDelay = us; }
+    // Answer every configuration request with all settings, as some firmware does.
+    void setFullConfigurationReplies(bool full) { fullConfigurationReplies = full; }
+
+    bool isEnabled() const { return enabled; }
+    const Stats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+    bool receive(const uint8_t *data, size_t length) override;
+    void transmit(uint8_t *data, size_t length) override;
+    void tick(unsigned long nowMicros) override;
+
+private:
+    typedef struct Frame
+    {
+        uint8_t data[SIM_ZFORCE_MAX_FRAME];
+        uint8_t length;
+        unsigned long readyAt;
+    } Frame;
+
+    Frame *beginFrame(uint8_t type, unsigned long readyAt);
+    void endFrame(Frame *frame);
+    void queueBootComplete();
+    void queueTouchNotification();
+    void handleEnable(const uint8_t *body, uint8_t length, unsigned long now);
+    void handleConfiguration(const uint8_t *body, uint8_t length, unsigned long now);
+    void updateDataReady(unsigned long now);
+
+    const uint32_t dataReadyPin;
+    bool attached;
+
+    Frame queue[SIM_ZFORCE_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+    uint8_t readOffset;
+    bool frameJustRead;
+    unsigned long lastFrameReadAt;
+
+    bool enabled;
+    uint16_t minX, minY, maxX, maxY;
+    bool reverseX, reverseY, flipXY;
+    uint8_t reportedTouches;
+
+    unsigned int touchRate;
+    uint8_t fingers;
+    uint16_t strokeLength;
+    uint16_t strokeStep;
+    unsigned long nextTouchAt;
+    unsigned long responseDelay;
+    bool fullConfigurationReplies;
+
+    Stats stats;
+};
+
+// The sensor at SIM_ZFORCE_ADDRESS on PIN_NN_DR that HostMain.cpp runs.
+extern SimZforce simSensor;
@@ -0,0 +1,82 @@
+#include "WString.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string toBase(unsigned long value, unsigned char base)
+{
+    if (base < 2)
+        base = 10;
+    char buf[8 * sizeof(long) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    do
+    {
+        unsigned long digit = value % base;
+        *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+    return std::string(p);
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base)
+{
+    if (base == 10 && value < 0)
+        str = "-" + toBase((unsigned long)-value, base);
+    else
+        str = toBase((unsigned long)value, base);
+}
+
+String::String(unsigned long value, unsigned char base) : str(toBase(value, base)) {}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+    if (fromIndex >= str.length())
+        return -1;
+    std::string::size_type pos = str.find(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &s, unsigned int fromIndex) const
+{
+    if (fromIndex >= str.length())
+        return -1;
+    std::string::size_type pos = str.find(s.str, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        unsigned int temp = endIndex;
+        endIndex = beginIndex;
+        beginIndex = temp;
+    }
+    if (beginIndex >= str.length())
+        return String();
+    if (endIndex > str.length())
+        endIndex = str.length();
+    return String(str.substr(beginIndex, endIndex - beginIndex));
+}
+
+long String::toInt() const
+{
+    return atol(str.c_str());
+}
+
+void String::trim()
+{
+    static const char *whitespace = " \t\r\n\f\v";
+    std::string::size_type begin = str.find_first_not_of(whitespace);
+    if (begin == std::string::npos)
+    {
+        str.clear();
+        return;
+    }
+    std::string::size_type end = str.find_last_not_of(whitespace);
+    str = str.substr(begin, end - begin + 1);
+}
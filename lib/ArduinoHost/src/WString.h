@@ -0,0 +1,57 @@
+/*  Minimal Arduino String for host builds
+
+    Only the subset of the Arduino String API used by this project is
+    provided. The storage is a std::string so the semantics of indexOf,
+    substring and toInt match the Arduino core closely enough for the
+    register protocol in SensorHelper.
+*/
+#pragma once
+
+#include <string>
+
+class __FlashStringHelper;
+
+class String
+{
+public:
+    String() {}
+    String(const char *cstr) : str(cstr ? cstr : "") {}
+    String(const std::string &s) : str(s) {}
+    explicit String(char c) : str(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+
+    unsigned int length() const { return (unsigned int)str.length(); }
+    const char *c_str() const { return str.c_str(); }
+
+    int indexOf(char ch) const { return indexOf(ch, 0); }
+    int indexOf(char ch, unsigned int fromIndex) const;
+    int indexOf(const String &s) const { return indexOf(s, 0); }
+    int indexOf(const String &s, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+    long toInt() const;
+    void trim();
+
+    bool concat(const String &s) { str += s.str; return true; }
+    bool concat(const char *cstr) { str += cstr ? cstr : ""; return true; }
+    bool concat(char c) { str += c; return true; }
+    String &operator+=(const String &rhs) { concat(rhs); return *this; }
+    String &operator+=(const char *rhs) { concat(rhs); return *this; }
+    String &operator+=(char rhs) { concat(rhs); return *this; }
+
+    bool equals(const String &s) const { return str == s.str; }
+    bool equals(const char *cstr) const { return str == (cstr ? cstr : ""); }
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *rhs) const { return equals(rhs); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *rhs) const { return !equals(rhs); }
+
+    char charAt(unsigned int index) const { return index < str.length() ? str[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+private:
+    std::string str;
+};
@@ -0,0 +1,97 @@
+#include "Wire.h"
+#include "HostArduino.h"
+
+// Start, address byte with ACK and stop, in SCL periods.
+#define WIRE_OVERHEAD_BITS 11
+#define WIRE_BITS_PER_BYTE 9
+
+static void accountBusTime(uint32_t clock, size_t bytes)
+{
+    unsigned long bits = WIRE_OVERHEAD_BITS + WIRE_BITS_PER_BYTE * (unsigned long)bytes;
+    HostArduino::advanceMicros((bits * 1000000UL + clock - 1) / clock);
+}
+
+TwoWire::TwoWire() : clock(100000), txAddress(0), txLength(0), rxLength(0), rxIndex(0) {}
+
+void TwoWire::begin() {}
+
+void TwoWire::end() {}
+
+void TwoWire::setClock(uint32_t frequency)
+{
+    if (frequency > 0)
+        clock = frequency;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    txAddress = address;
+    txLength = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    accountBusTime(clock, txLength);
+    I2cDevice *device = HostArduino::findDevice(txAddress);
+    size_t length = txLength;
+    txLength = 0;
+    if (device == nullptr)
+        return 2; // address NACK
+    if (!device->receive(txBuffer, length))
+        return 3; // data NACK
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool sendStop)
+{
+    (void)sendStop;
+    if (quantity > BUFFER_LENGTH)
+        quantity = BUFFER_LENGTH;
+    rxIndex = 0;
+    rxLength = 0;
+    I2cDevice *device = HostArduino::findDevice(address);
+    if (device == nullptr)
+    {
+        accountBusTime(clock, 0);
+        return 0;
+    }
+    device->transmit(rxBuffer, quantity);
+    accountBusTime(clock, quantity);
+    rxLength = quantity;
+    return quantity > 0xFF ? 0xFF : (uint8_t)quantity;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (txLength >= BUFFER_LENGTH)
+        return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+    size_t n = 0;
+    while (n < quantity && write(data[n]))
+        n++;
+    return n;
+}
+
+int TwoWire::available() { return (int)(rxLength - rxIndex); }
+
+int TwoWire::read()
+{
+    if (rxIndex >= rxLength)
+        return -1;
+    return rxBuffer[rxIndex++];
+}
+
+int TwoWire::peek()
+{
+    if (rxIndex >= rxLength)
+        return -1;
+    return rxBuffer[rxIndex];
+}
+
+TwoWire Wire;
@@ -0,0 +1,50 @@
+/*  Arduino Wire (TwoWire) shim for host builds
+
+    Transactions are routed to the I2C devices attached with
+    HostArduino::attachDevice(). Reads and writes are staged in a
+    BUFFER_LENGTH byte buffer (256 as in the SAMD core, build with
+    -DBUFFER_LENGTH=32 to model AVR), and every transaction advances
+    the host clock by the time it would take on a real bus at the
+    configured clock rate.
+*/
+#pragma once
+
+#include "Arduino.h"
+
+#ifndef BUFFER_LENGTH
+#define BUFFER_LENGTH 256
+#endif
+
+class TwoWire : public Stream
+{
+public:
+    TwoWire();
+    void begin();
+    void end();
+    void setClock(uint32_t frequency);
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(bool sendStop = true);
+
+    uint8_t requestFrom(uint8_t address, size_t quantity, bool sendStop = true);
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (size_t)quantity); }
+
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *data, size_t quantity) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+
+private:
+    uint32_t clock;
+    uint8_t txAddress;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    size_t txLength;
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    size_t rxLength;
+    size_t rxIndex;
+};
+
+extern TwoWire Wire;
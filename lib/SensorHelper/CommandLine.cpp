@@ -0,0 +1,50 @@
+#include "CommandLine.h"
+
+CommandLine::CommandLine() : length(0), overflowed(false), lastInput(0)
+{
+    buffer[0] = '\0';
+    resetStats();
+}
+
+bool CommandLine::feed(char c, unsigned long now)
+{
+    lastInput = now;
+    if (c != '\r' && c != '\n')
+    {
+        if (length < COMMAND_LINE_LENGTH)
+            buffer[length++] = c;
+        else
+            overflowed = true;
+        return false;
+    }
+
+    if (overflowed)
+    {
+        stats.overflows++;
+        clear();
+        return false;
+    }
+    if (length == 0)
+        return false;
+    buffer[length] = '\0';
+    stats.commands++;
+    return true;
+}
+
+bool CommandLine::expired(unsigned long now)
+{
+    if ((length == 0 && !overflowed) || now - lastInput < COMMAND_LINE_IDLE_MS)
+        return false;
+
+    bool complete = feed('\n', now);
+    if (complete)
+        stats.idle++;
+    return complete;
+}
+
+void CommandLine::clear()
+{
+    length = 0;
+    overflowed = false;
+    buffer[0] = '\0';
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+
+#define COMMAND_LINE_LENGTH 24    // longest command, terminator excluded
+#define COMMAND_LINE_IDLE_MS 1000 // an unterminated command runs after this, like Stream::readString()
+
+typedef struct CommandLineStats
+{
+    unsigned long commands;
+    unsigned long overflows; // commands too long for the buffer, dropped
+    unsigned long idle;      // commands completed by the idle timeout instead of a terminator
+} CommandLineStats;
+
+/*
+ * Collects serial input into commands, one byte at a time, in a fixed buffer.
+ * A command ends with '\r' or '\n'; empty lines are skipped, so CR LF is one
+ * terminator. For senders that rely on the Stream timeout, a command that has
+ * had no input for COMMAND_LINE_IDLE_MS is complete as well.
+ */
+class CommandLine
+{
+public:
+    CommandLine();
+
+    // Takes one received byte; true when line() holds a complete command.
+    bool feed(char c, unsigned long now);
+    // True when an unterminated command has been idle long enough to run.
+    bool expired(unsigned long now);
+    const char *line() const { return buffer; }
+    // Called once the command in line() has been run.
+    void clear();
+
+    const CommandLineStats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    char buffer[COMMAND_LINE_LENGTH + 1];
+    uint8_t length;
+    bool overflowed;
+    unsigned long lastInput;
+    CommandLineStats stats;
+};
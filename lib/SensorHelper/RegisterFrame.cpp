@@ -0,0 +1,119 @@
+#include "RegisterFrame.h"
+
+uint16_t frameCrc(const uint8_t *data, size_t length, uint16_t crc)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out)
+{
+    size_t code = 0; // where the length of the current block goes
+    size_t written = 1;
+    uint8_t block = 1;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (in[i] != 0)
+        {
+            out[written++] = in[i];
+            block++;
+        }
+        if (in[i] == 0 || block == 0xFF)
+        {
+            out[code] = block;
+            code = written++;
+            block = 1;
+        }
+    }
+    out[code] = block;
+    return written;
+}
+
+// Works in place, out may be in, as the output never overtakes the input.
+size_t cobsDecode(const uint8_t *in, size_t length, uint8_t *out)
+{
+    size_t read = 0;
+    size_t written = 0;
+    while (read < length)
+    {
+        uint8_t block = in[read++];
+        if (block == 0 || read + block - 1 > length)
+            return 0;
+        for (uint8_t i = 1; i < block; i++)
+            out[written++] = in[read++];
+        if (block < 0xFF && read < length)
+            out[written++] = 0;
+    }
+    return written;
+}
+
+size_t encodeFrame(const uint8_t *payload, size_t length, uint8_t *out)
+{
+    uint8_t frame[FRAME_MAX_PAYLOAD + 2];
+    if (length > FRAME_MAX_PAYLOAD)
+        return 0;
+
+    memcpy(frame, payload, length);
+    uint16_t crc = frameCrc(payload, length);
+    frame[length] = crc & 0xFF;
+    frame[length + 1] = crc >> 8;
+    size_t size = cobsEncode(frame, length + 2, out);
+    out[size++] = FRAME_DELIMITER;
+    return size;
+}
+
+size_t writeFrame(Print &out, const uint8_t *payload, size_t length)
+{
+    uint8_t encoded[FRAME_MAX_ENCODED + 1];
+    size_t size = encodeFrame(payload, length, encoded);
+    return size > 0 ? out.write(encoded, size) : 0;
+}
+
+FrameReader::FrameReader() : received(0), payloadLength(0), overflowed(false)
+{
+    resetStats();
+}
+
+bool FrameReader::feed(uint8_t c)
+{
+    if (c != FRAME_DELIMITER)
+    {
+        if (received < FRAME_MAX_ENCODED)
+            buffer[received++] = c;
+        else
+            overflowed = true;
+        return false;
+    }
+
+    if (overflowed)
+    {
+        stats.overflows++;
+        clear();
+        return false;
+    }
+    if (received == 0)
+        return false; // delimiters in a row, or the one that selected the protocol
+
+    size_t size = cobsDecode(buffer, received, buffer);
+    received = 0;
+    if (size < 2 || frameCrc(buffer, size - 2) != (buffer[size - 2] | (uint16_t)buffer[size - 1] << 8))
+    {
+        stats.crcErrors++;
+        return false;
+    }
+    payloadLength = size - 2;
+    stats.frames++;
+    return true;
+}
+
+void FrameReader::clear()
+{
+    received = 0;
+    payloadLength = 0;
+    overflowed = false;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <Arduino.h>
+
+#define FRAME_MAX_REGS 16                              // registers in one burst
+#define FRAME_MAX_PAYLOAD (3 + FRAME_MAX_REGS * 4)     // command, address, count, values
+#define FRAME_MAX_ENCODED (FRAME_MAX_PAYLOAD + 2 + 1)  // with the CRC and the COBS overhead byte
+#define FRAME_DELIMITER 0x00
+
+/*
+ * Binary register protocol. Every frame is a payload and its CRC-16 (CCITT,
+ * initial value 0xFFFF, low byte first), COBS encoded and followed by a 0x00
+ * delimiter. Register values are 32 bit, low byte first.
+ *
+ *   request                          reply
+ *   READ  addr count                 READ|REPLY addr count value...
+ *   WRITE addr count value...        WRITE|REPLY addr count ok
+ *   TEXT                             TEXT|REPLY, then back to the text commands
+ *   SUBSCRIBE addr count interval    SUBSCRIBE|REPLY addr count ok
+ *   UNSUBSCRIBE [addr count]         UNSUBSCRIBE|REPLY removed, all without a range
+ *   anything else or broken          ERROR command FrameError
+ *
+ * Telemetry frames are sent without a request:
+ *
+ *   TOUCH sequence sensor count, then per touch x y (16 bit) id event (8 bit)
+ *   READ|REPLY addr count value...   registers, as diagnostics
+ *   NOTIFY addr count value...       the changed part of a subscribed range
+ *
+ * A subscription's interval (16 bit, ms) is the least time between two of
+ * its NOTIFY frames; changes in between are sent together.
+ */
+enum class FrameCommand : uint8_t
+{
+    READ = 0x01,
+    WRITE = 0x02,
+    TEXT = 0x03,
+    SUBSCRIBE = 0x04,
+    UNSUBSCRIBE = 0x05,
+    TOUCH = 0x10,
+    NOTIFY = 0x11,
+    REPLY = 0x80, // or'ed into the command of a reply
+    ERROR = 0xFF
+};
+
+enum class FrameError : uint8_t
+{
+    LENGTH = 1,  // the payload does not match its command
+    COMMAND = 2, // unknown command
+    RANGE = 3,   // registers past the register map, or too many for one frame
+    FULL = 4,    // no room for another subscription
+    VALUE = 5    // a write to a read only register, or of a value out of its range; nothing is written
+};
+
+typedef struct FrameStats
+{
+    unsigned long frames;
+    unsigned long crcErrors;
+    unsigned long overflows; // frames too long for the buffer
+} FrameStats;
+
+uint16_t frameCrc(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+// Both return the output length; decoding returns 0 for a broken encoding.
+size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out);
+size_t cobsDecode(const uint8_t *in, size_t length, uint8_t *out);
+
+// Adds the CRC, encodes and appends the delimiter; out holds FRAME_MAX_ENCODED + 1 bytes.
+size_t encodeFrame(const uint8_t *payload, size_t length, uint8_t *out);
+// The same, written to out.
+size_t writeFrame(Print &out, const uint8_t *payload, size_t length);
+
+/*
+ * Collects received bytes into frames, like CommandLine does for text. The
+ * frame is decoded in place once its delimiter arrives, so there is a single
+ * buffer of FRAME_MAX_ENCODED bytes.
+ */
+class FrameReader
+{
+public:
+    FrameReader();
+
+    // Takes one received byte; true when payload() holds a frame with a good CRC.
+    bool feed(uint8_t c);
+    const uint8_t *payload() const { return buffer; }
+    size_t length() const { return payloadLength; }
+    void clear();
+
+    const FrameStats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    uint8_t buffer[FRAME_MAX_ENCODED];
+    uint8_t received;
+    uint8_t payloadLength;
+    bool overflowed;
+    FrameStats stats;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <Arduino.h>
+
+enum class RegAccess : uint8_t
+{
+    R = 0, // written by the library only
+    RW = 1
+};
+
+// Bytes a register takes in the register store; values are unsigned.
+enum class RegWidth : uint8_t
+{
+    U8 = 1,
+    U16 = 2
+};
+
+/*
+ * One line of a register table: count registers from first, step apart, that
+ * share access, width, the largest value a host may write and the handler
+ * that applies a write. The registers of a table must cover every address
+ * from 0 once.
+ */
+typedef struct RegRow
+{
+    uint8_t first;
+    uint8_t count;
+    uint8_t step;
+    RegAccess access;
+    RegWidth width;
+    uint16_t max;
+    uint8_t handler;
+} RegRow;
+
+/*
+ * What the table says about one address, packed into 4 bytes: flags holds
+ * REG_FLAG_RW, REG_FLAG_U16 and the handler in the high nibble, offset is the
+ * first byte of the value in the register store.
+ */
+typedef struct RegInfo
+{
+    uint8_t flags;
+    uint8_t offset;
+    uint16_t max;
+} RegInfo;
+
+#define REG_FLAG_RW 0x01
+#define REG_FLAG_U16 0x02
+#define REG_HANDLER_SHIFT 4
+#define REG_MAX_HANDLERS 16
+
+// All of these run at compile time, over a table that is a constexpr array.
+
+constexpr bool regRowCovers(const RegRow &row, unsigned addr)
+{
+    return addr >= row.first && (addr - row.first) % row.step == 0 && (addr - row.first) / row.step < row.count;
+}
+
+// The row of addr, or rows when there is none.
+constexpr uint8_t regRowOf(const RegRow *table, uint8_t rows, unsigned addr, uint8_t row = 0)
+{
+    return row == rows || regRowCovers(table[row], addr) ? row : regRowOf(table, rows, addr, row + 1);
+}
+
+constexpr uint8_t regRowsCovering(const RegRow *table, uint8_t rows, unsigned addr, uint8_t row = 0)
+{
+    return row == rows ? 0 : regRowCovers(table[row], addr) + regRowsCovering(table, rows, addr, row + 1);
+}
+
+// True if every address below count is in exactly one row.
+constexpr bool regTableIsComplete(const RegRow *table, uint8_t rows, unsigned count)
+{
+    return count == 0 || (regRowsCovering(table, rows, count - 1) == 1 && regTableIsComplete(table, rows, count - 1));
+}
+
+constexpr unsigned regStoreOffset(const RegRow *table, uint8_t rows, unsigned addr)
+{
+    return addr == 0 ? 0 : regStoreOffset(table, rows, addr - 1) + (unsigned)table[regRowOf(table, rows, addr - 1)].width;
+}
+
+constexpr RegInfo regInfo(const RegRow *table, uint8_t rows, unsigned addr)
+{
+    return RegInfo{(uint8_t)((table[regRowOf(table, rows, addr)].access == RegAccess::RW ? REG_FLAG_RW : 0) |
+                             (table[regRowOf(table, rows, addr)].width == RegWidth::U16 ? REG_FLAG_U16 : 0) |
+                             table[regRowOf(table, rows, addr)].handler << REG_HANDLER_SHIFT),
+                   (uint8_t)regStoreOffset(table, rows, addr),
+                   table[regRowOf(table, rows, addr)].max};
+}
+
+// 0, 1, ... Count - 1 as a parameter pack, to expand a table into one entry per address.
+template <unsigned... Index>
+struct RegIndices
+{
+};
+
+template <unsigned Count, unsigned... Index>
+struct MakeRegIndices : MakeRegIndices<Count - 1, Count - 1, Index...>
+{
+};
+
+template <unsigned... Index>
+struct MakeRegIndices<0, Index...>
+{
+    typedef RegIndices<Index...> type;
+};
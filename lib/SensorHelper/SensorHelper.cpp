@@ -1,23 +1,211 @@
 #include "SensorHelper.h"
+#include "RegisterMap.h"
 #include "Streaming.h"
+#if ZFORCE_SERCOM_DMA
+#include "SercomDma/SercomDma.h"
+#endif
 
 namespace SensorHelper
 {
-#define TOUCH_BUFFER_SIZE 2 // must not exeed 4
-uint8_t nTouches = 0;
-#define MAX_REGS (reg_R_Touch + TOUCH_BUFFER_SIZE * 4)
-sensor_val_t regs[MAX_REGS];
-volatile bool newTouchDataFlag = false;
+TouchSlots<TOUCH_SLOTS> touchSlots;
+TouchRecord slotRecord; // the frame going into the slots
+uint8_t slotNext = 0;   // its first entry not in the slots yet
+#define MAX_REGS regCount
 
-void dataReadyISR() { newTouchDataFlag = true; }
+// What a write from the host does besides storing the value, see regHandlers.
+enum RegHandler : uint8_t
+{
+    HANDLER_NONE,
+    HANDLER_ENABLE,
+    HANDLER_READ_TRIGGER,
+    HANDLER_AREA,
+    HANDLER_DEAD_BAND,
+    HANDLER_COUNT
+};
 
-bool isDataReady() { return digitalRead(PIN_NN_DR) == HIGH; }
+// One line per register, or per run of registers that are alike.
+constexpr RegRow regRows[] = {
+    // first                count        step access         width          max     handler
+    {reg_R_Status,          1,           1,   RegAccess::R,  RegWidth::U8,  0xFF,   HANDLER_NONE},
+    {reg_R_Bootcomplete,    1,           1,   RegAccess::R,  RegWidth::U8,  1,      HANDLER_NONE},
+    {reg_RW_Enable,         1,           1,   RegAccess::RW, RegWidth::U8,  1,      HANDLER_ENABLE},
+    {reg_RW_Frequency,      1,           1,   RegAccess::RW, RegWidth::U16, 0xFFFF, HANDLER_NONE}, // the library has no request for it
+    {reg_R_Sensor,          1,           1,   RegAccess::R,  RegWidth::U8,  0xFF,   HANDLER_NONE},
+    {reg_RW_ReadTrigger,    1,           1,   RegAccess::RW, RegWidth::U8,  1,      HANDLER_READ_TRIGGER},
+    {reg_RW_Area,           4,           1,   RegAccess::RW, RegWidth::U16, 0xFFFF, HANDLER_AREA},
+    {reg_R_Touch + 0,       TOUCH_SLOTS, 4,   RegAccess::R,  RegWidth::U16, 0xFFFF, HANDLER_NONE}, // x
+    {reg_R_Touch + 1,       TOUCH_SLOTS, 4,   RegAccess::R,  RegWidth::U16, 0xFFFF, HANDLER_NONE}, // y
+    {reg_R_Touch + 2,       TOUCH_SLOTS, 4,   RegAccess::R,  RegWidth::U8,  0xFF,   HANDLER_NONE}, // id
+    {reg_R_Touch + 3,       TOUCH_SLOTS, 4,   RegAccess::R,  RegWidth::U8,  0xFF,   HANDLER_NONE}, // event
+    {reg_RW_DeadBandX,      2,           1,   RegAccess::RW, RegWidth::U16, 0xFFFF, HANDLER_DEAD_BAND},
+    {reg_R_ActiveSlots,     2,           1,   RegAccess::R,  RegWidth::U16, 0xFFFF, HANDLER_NONE},
+};
+constexpr uint8_t regRowCount = sizeof(regRows) / sizeof(regRows[0]);
+static_assert(regTableIsComplete(regRows, regRowCount, MAX_REGS), "every register needs exactly one row in regRows");
+static_assert(HANDLER_COUNT <= REG_MAX_HANDLERS, "RegInfo::flags has 4 bits for the handler");
 
-bool writeReg(sensor_reg_t addr, sensor_val_t val, bool sendToZforce)
+// regRows expanded to one RegInfo per address at compile time.
+template <typename Indices>
+struct RegTable;
+
+template <unsigned... Addr>
+struct RegTable<RegIndices<Addr...> >
+{
+    static constexpr RegInfo info[] = {regInfo(regRows, regRowCount, Addr)...};
+};
+
+template <unsigned... Addr>
+constexpr RegInfo RegTable<RegIndices<Addr...> >::info[];
+
+typedef RegTable<MakeRegIndices<MAX_REGS>::type> Registers;
+
+// Every value at its own width, little endian.
+constexpr unsigned regStoreSize = regStoreOffset(regRows, regRowCount, MAX_REGS);
+static_assert(regStoreSize <= 0x100, "RegInfo::offset is 8 bit");
+uint8_t regStore[regStoreSize];
+
+static sensor_val_t loadReg(sensor_reg_t addr)
+{
+    const RegInfo &info = Registers::info[addr];
+    const uint8_t *value = &regStore[info.offset];
+    return info.flags & REG_FLAG_U16 ? value[0] | (uint16_t)value[1] << 8 : value[0];
+}
+
+typedef struct Subscription
+{
+    sensor_reg_t addr;
+    uint8_t count;          // 0 for a free slot
+    uint16_t interval;      // ms
+    unsigned long lastSent; // millis()
+    uint16_t changed;       // bit per register of the range
+} Subscription;
+
+Subscription subscriptions[SUBSCRIPTION_MAX];
+static_assert(FRAME_MAX_REGS <= 16, "Subscription::changed has a bit per register of a frame");
+
+// All register updates go through here, so that subscriptions see the changes.
+void setReg(sensor_reg_t addr, sensor_val_t val)
+{
+    const RegInfo &info = Registers::info[addr];
+    uint8_t *value = &regStore[info.offset];
+    if (loadReg(addr) == val)
+        return;
+    value[0] = val;
+    if (info.flags & REG_FLAG_U16)
+        value[1] = val >> 8;
+    for (uint8_t i = 0; i < SUBSCRIPTION_MAX; i++)
+    {
+        Subscription &subscription = subscriptions[i];
+        if (addr >= subscription.addr && addr < subscription.addr + subscription.count)
+            subscription.changed |= 1 << (addr - subscription.addr);
+    }
+}
+
+typedef struct Sensor
+{
+    ZforceBase *zforce;
+    uint32_t dataReadyPin;
+    bool present;
+    CommandQueue commands;
+    volatile bool newTouchDataFlag;
+    volatile unsigned long readySince; // micros() of the data ready edge that set the flag
+    SensorStats stats;
+} Sensor;
+
+Sensor sensors[SENSOR_MAX_SENSORS];
+static_assert(SENSOR_MAX_SENSORS <= FUSION_MAX_SENSORS, "every sensor needs a transform");
+TouchFusion fusion(TOUCH_SLOTS); // a fused frame never holds more touches than there are slots
+TouchRing<TOUCH_RING_DEPTH> touchRing;
+TouchFilter touchFilter;
+CommandLine commandLine;
+FrameReader frameReader;
+TxQueue txQueue;
+static_assert(TX_QUEUE_SIZE >= 1 + FRAME_MAX_ENCODED + 1, "every priority of txQueue must take a full frame");
+uint16_t regsCursor = MAX_REGS; // the next register of the dump queueRegs() started, MAX_REGS (up to 256) if none
+uint8_t touchSequence = 0;
+SerialProtocol serialProtocol = SerialProtocol::TEXT;
+uint8_t nSensors = 0;
+uint8_t lastServiced = 0; // the scheduler looks at the sensors after this one first
+volatile ReadTrigger readTrigger = ReadTrigger::LOOP;
+volatile bool producing = false; // a sensor is being read, or touches queued, outside the interrupt
+
+void readFromInterrupt(uint8_t index);
+
+template <uint8_t Index>
+void dataReadyISR()
+{
+    Sensor &sensor = sensors[Index];
+    if (!sensor.newTouchDataFlag)
+    {
+        sensor.readySince = micros();
+        sensor.newTouchDataFlag = true;
+    }
+    if (readTrigger == ReadTrigger::DATA_READY)
+        readFromInterrupt(Index);
+}
+
+// attachInterrupt() takes no argument, so there is one handler per sensor.
+void (*const dataReadyISRs[])() = {dataReadyISR<0>, dataReadyISR<1>, dataReadyISR<2>, dataReadyISR<3>};
+static_assert(sizeof(dataReadyISRs) / sizeof(dataReadyISRs[0]) == SENSOR_MAX_SENSORS, "one data ready handler per sensor");
+
+bool addSensor(ZforceBase &zforce, uint32_t dataReadyPin)
+{
+#if ZFORCE_SERCOM_DMA
+    // There is one DMA engine and it reads for one sensor.
+    if (nSensors == 1)
+        return false;
+#endif
+    if (nSensors == SENSOR_MAX_SENSORS)
+        return false;
+
+    Sensor &sensor = sensors[nSensors++];
+    sensor.zforce = &zforce;
+    sensor.dataReadyPin = dataReadyPin;
+    sensor.present = true;
+    sensor.commands.Attach(zforce);
+    sensor.newTouchDataFlag = false;
+    memset(&sensor.stats, 0, sizeof(sensor.stats));
+    return true;
+}
+
+uint8_t sensorCount() { return nSensors; }
+
+bool isSensorPresent(uint8_t index) { return index < nSensors && sensors[index].present; }
+
+CommandQueue &commands(uint8_t index) { return sensors[index].commands; }
+
+const SensorStats &sensorStats(uint8_t index) { return sensors[index].stats; }
+
+void resetSensorStats()
+{
+    for (uint8_t i = 0; i < nSensors; i++)
+        memset(&sensors[i].stats, 0, sizeof(sensors[i].stats));
+}
+
+void setReadTrigger(ReadTrigger trigger)
+{
+    readTrigger = trigger;
+    setReg(reg_RW_ReadTrigger, (sensor_val_t)trigger);
+}
+
+ReadTrigger getReadTrigger() { return readTrigger; }
+
+bool isDataReady(uint8_t index) { return digitalRead(sensors[index].dataReadyPin) == HIGH; }
+
+// Whether the host may write val to addr; anything else is rejected before it is stored.
+bool isWritable(sensor_reg_t addr, sensor_val_t val)
 {
     if (addr >= MAX_REGS)
         return false;
-    regs[addr] = val;
+    const RegInfo &info = Registers::info[addr];
+    return (info.flags & REG_FLAG_RW) && val >= 0 && val <= info.max;
+}
+
+bool writeReg(sensor_reg_t addr, sensor_val_t val, bool sendToZforce)
+{
+    if (!isWritable(addr, val))
+        return false;
+    setReg(addr, val);
 
     if (sendToZforce)
         return sendAndGetFromZforce(addr);
@@ -25,115 +213,380 @@ bool writeReg(sensor_reg_t addr, sensor_val_t val, bool sendToZforce)
         return true;
 }
 
-bool sendAndGetFromZforce(sensor_reg_t addr)
+// Latest command result in reg_R_Status, a CommandStatus value.
+void commandDone(uint16_t handle, CommandStatus status, const MessageVariant *response, void *context)
 {
-    if (addr == reg_RW_Enable)
-        zforce.Enable(regs[addr]);
-    else if (addr == reg_RW_Frequency)
+    setReg(reg_R_Status, (sensor_val_t)status);
+    if (status != CommandStatus::DONE)
+        return;
+
+    const TouchActiveAreaData *area = nullptr;
+    if (response->type == MessageType::TOUCHACTIVEAREATYPE)
+        area = &response->touchActiveArea;
+    else if (response->type == MessageType::DEVICECONFIGURATIONTYPE &&
+             (response->configuration.fields & CONFIG_TOUCH_ACTIVE_AREA))
+        area = &response->configuration.touchActiveArea;
+
+    if (area != nullptr)
     {
-        /* code */
+        setReg(reg_RW_Area + 0, area->minX);
+        setReg(reg_RW_Area + 1, area->minY);
+        setReg(reg_RW_Area + 2, area->maxX);
+        setReg(reg_RW_Area + 3, area->maxY);
     }
-    else if (addr == reg_RW_Area)
+}
+
+// Queues the request on every present sensor.
+bool submitToSensors(const CommandRequest &request)
+{
+    bool submitted = true;
+    for (uint8_t i = 0; i < nSensors; i++)
     {
-        zforce.TouchActiveArea(regs[addr], regs[addr + 1],
-                               regs[addr + 2], regs[addr + 3]);
+        if (sensors[i].present)
+            submitted = sensors[i].commands.Submit(request, commandDone) != COMMAND_INVALID_HANDLE && submitted;
     }
+    return submitted;
+}
 
-    while (!isDataReady())
-        ;
-    Message *msg = zforce.GetMessage();
-    if (msg == NULL)
-        return false;
-    zforce.DestroyMessage(msg);
-    newTouchDataFlag = false;   // clear flag
+bool applyEnable(sensor_reg_t addr)
+{
+    CommandRequest request;
+    request.type = MessageType::ENABLETYPE;
+    request.enabled = loadReg(addr);
+    return submitToSensors(request);
+}
+
+bool applyReadTrigger(sensor_reg_t addr)
+{
+    setReadTrigger(loadReg(addr) ? ReadTrigger::DATA_READY : ReadTrigger::LOOP);
+    return true;
+}
+
+// Any of the four registers sends the whole area.
+bool applyArea(sensor_reg_t addr)
+{
+    CommandRequest request;
+    request.type = MessageType::TOUCHACTIVEAREATYPE;
+    request.touchActiveArea.minX = loadReg(reg_RW_Area + 0);
+    request.touchActiveArea.minY = loadReg(reg_RW_Area + 1);
+    request.touchActiveArea.maxX = loadReg(reg_RW_Area + 2);
+    request.touchActiveArea.maxY = loadReg(reg_RW_Area + 3);
+    return submitToSensors(request);
+}
+
+bool applyDeadBand(sensor_reg_t addr)
+{
+    touchFilter.setDeadBand(loadReg(reg_RW_DeadBandX), loadReg(reg_RW_DeadBandY));
     return true;
 }
 
+bool applyNothing(sensor_reg_t addr) { return true; }
+
+// Indexed by RegHandler.
+bool (*const regHandlers[])(sensor_reg_t addr) = {applyNothing, applyEnable, applyReadTrigger, applyArea, applyDeadBand};
+static_assert(sizeof(regHandlers) / sizeof(regHandlers[0]) == HANDLER_COUNT, "one function per RegHandler");
+
+static uint8_t handlerOf(sensor_reg_t addr) { return Registers::info[addr].flags >> REG_HANDLER_SHIFT; }
+
+// Applies a register written by the host; requests for the sensors are handled by updateTouch().
+bool sendAndGetFromZforce(sensor_reg_t addr)
+{
+    if (addr >= MAX_REGS)
+        return false;
+    return regHandlers[handlerOf(addr)](addr);
+}
+
+// Applies several settings with one request instead of one round trip each.
+bool configure(const DeviceConfiguration &config)
+{
+    CommandRequest request;
+    request.type = MessageType::DEVICECONFIGURATIONTYPE;
+    request.configuration = config;
+    return submitToSensors(request);
+}
+
+// Runs the queued commands to completion; bounded by the command timeouts.
+void flushCommands()
+{
+    MessageVariant msg;
+    producing = true;
+    for (uint8_t i = 0; i < nSensors; i++)
+    {
+        while (!sensors[i].commands.IsIdle())
+            sensors[i].commands.Poll(msg);
+        sensors[i].newTouchDataFlag = false;
+    }
+    producing = false;
+}
+
 sensor_val_t readReg(sensor_reg_t addr)
 {
     if (addr >= MAX_REGS)
         return 0;
 
-    return regs[addr];
+    return loadReg(addr);
 }
 
-bool begin()
+// Starts the sensors; with discover, the ones that do not answer their address are left out.
+bool begin(bool discover)
 {
-    zforce.Start(PIN_NN_DR);
-    pinMode(PIN_NN_DR, INPUT_PULLDOWN);
-    if (isDataReady())
+    if (nSensors == 0)
+        addSensor(zforce, PIN_NN_DR);
+
+    bool found = false;
+    for (uint8_t i = 0; i < nSensors; i++)
     {
-        Message *msg = zforce.GetMessage();
-        if (msg->type == MessageType::BOOTCOMPLETETYPE)
-            Serial << "Sensor connected" << endl;
-        else
-            Serial << "Unexpected senosr message" << endl;
-        zforce.DestroyMessage(msg);
+        Sensor &sensor = sensors[i];
+        sensor.zforce->Start(sensor.dataReadyPin);
+        pinMode(sensor.dataReadyPin, INPUT_PULLDOWN);
+        if (discover && !sensor.zforce->Probe())
+        {
+            sensor.present = false;
+            Serial << "No sensor at 0x" << _HEX(sensor.zforce->GetAddress()) << endl;
+            continue;
+        }
+        found = true;
+        if (digitalRead(sensor.dataReadyPin) == HIGH)
+        {
+            MessageVariant msg;
+            if (sensor.zforce->GetMessage(msg) && msg.type == MessageType::BOOTCOMPLETETYPE)
+                Serial << "Sensor connected at 0x" << _HEX(sensor.zforce->GetAddress()) << endl;
+            else
+                Serial << "Unexpected senosr message" << endl;
+        }
     }
-    return true;
+#if ZFORCE_SERCOM_DMA
+    // The DMA transport owns the data ready interrupt and reports read frames instead.
+    sercomDma.SetCallback(dataReadyISRs[0]);
+#endif
+    return found;
 }
 
 void config(uint8_t index)
 {
-    detachInterrupt(digitalPinToInterrupt(PIN_NN_DR));
+    // The sensor sends no more touches than there are slots for.
+    CommandRequest request;
+    request.type = MessageType::REPORTEDTOUCHESTYPE;
+    request.reportedTouches = TOUCH_SLOTS;
+    submitToSensors(request);
+#if ZFORCE_SERCOM_DMA
+    writeReg(reg_RW_Enable, true);
+    flushCommands();
+#else
+    for (uint8_t i = 0; i < nSensors; i++)
+        detachInterrupt(digitalPinToInterrupt(sensors[i].dataReadyPin));
     writeReg(reg_RW_Enable, true);
-    attachInterrupt(digitalPinToInterrupt(PIN_NN_DR), dataReadyISR, RISING);
+    flushCommands();
+    for (uint8_t i = 0; i < nSensors; i++)
+    {
+        if (!sensors[i].present)
+            continue;
+        attachInterrupt(digitalPinToInterrupt(sensors[i].dataReadyPin), dataReadyISRs[i], RISING);
+        // A frame that came in meanwhile raised data ready before there was a handler.
+        if (isDataReady(i))
+            dataReadyISRs[i]();
+    }
+#endif
     SensorHelper::printRegs();
     Serial << "Sensor configured" << endl << endl;
 }
 
-void mapTouchdataToRegs(TouchData *touch, uint8_t index)
+void mapTouchdataToRegs(const TouchData *touch, uint8_t index)
 {
     auto i = index;
-    regs[reg_R_Touch + i * 4 + 0] = touch->x;
-    regs[reg_R_Touch + i * 4 + 1] = touch->y;
-    regs[reg_R_Touch + i * 4 + 2] = touch->id;
-    regs[reg_R_Touch + i * 4 + 3] = touch->event;
+    setReg(reg_R_Touch + i * 4 + 0, touch->x);
+    setReg(reg_R_Touch + i * 4 + 1, touch->y);
+    setReg(reg_R_Touch + i * 4 + 2, touch->id);
+    setReg(reg_R_Touch + i * 4 + 3, touch->event);
 }
 
 void getTouchdataFromRegs(TouchData &touch, uint8_t index)
 {
     auto i = index;
-    touch.x = regs[reg_R_Touch + i * 4 + 0];
-    touch.y = regs[reg_R_Touch + i * 4 + 1];
-    touch.id = regs[reg_R_Touch + i * 4 + 2];
-    touch.event = (TouchEvent)regs[reg_R_Touch + i * 4 + 3];
+    touch.x = loadReg(reg_R_Touch + i * 4 + 0);
+    touch.y = loadReg(reg_R_Touch + i * 4 + 1);
+    touch.id = loadReg(reg_R_Touch + i * 4 + 2);
+    touch.event = (TouchEvent)loadReg(reg_R_Touch + i * 4 + 3);
 }
 
-uint8_t updateTouch()
+bool needsService(const Sensor &sensor)
+{
+    return sensor.present && (sensor.newTouchDataFlag || !sensor.commands.IsIdle());
+}
+
+/*
+ * Reads at most one message of a sensor; true if msg holds a notification,
+ * which became ready at readySince.
+ */
+bool serviceSensor(Sensor &sensor, MessageVariant &msg, unsigned long &readySince, bool inInterrupt)
 {
-    if (newTouchDataFlag == false)
+    bool timed = sensor.newTouchDataFlag;
+    readySince = timed ? sensor.readySince : micros();
+    unsigned long nextReadySince = readySince;
+    sensor.newTouchDataFlag = false;
+    // Commands are only sent from loop(), so an interrupt never gets a response.
+    bool notification = inInterrupt ? sensor.zforce->GetMessage(msg) : sensor.commands.Poll(msg);
+
+    if (notification)
     {
-        return 0;
+        SensorStats &stats = sensor.stats;
+        stats.frames++;
+        if (timed)
+        {
+            unsigned long latency = micros() - readySince;
+            stats.timedFrames++;
+            stats.lastLatency = latency;
+            stats.totalLatency += latency;
+            if (latency > stats.maxLatency)
+                stats.maxLatency = latency;
+        }
+        nextReadySince = micros();
     }
+    // A frame that was not read, or the next one, does not raise another edge.
+    if (!inInterrupt)
+        noInterrupts();
+    if (!sensor.newTouchDataFlag && sensor.zforce->GetDataReady() == HIGH)
+    {
+        sensor.readySince = nextReadySince;
+        sensor.newTouchDataFlag = true;
+    }
+    if (!inInterrupt)
+        interrupts();
+    return notification;
+}
 
-    newTouchDataFlag = false;
-    Message *touch = zforce.GetMessage();
-    if (touch != NULL)
+/*
+ * Queues the touches of a notification, fused with several sensors, unless
+ * touchFilter holds them back; false if nothing was queued.
+ */
+bool queueTouches(uint8_t index, const MessageVariant &msg, unsigned long readySince)
+{
+    if (msg.type != MessageType::TOUCHTYPE)
+        return false;
+    sensors[index].stats.touchFrames++;
+    if (nSensors > 1)
+    {
+        TouchFrame fused;
+        fusion.fuse(index, msg.touch, fused);
+        if (!touchFilter.pass(fused))
+            return false;
+        touchRing.push(index, fused, readySince);
+    }
+    else
     {
-        if (touch->type == MessageType::TOUCHTYPE)
+        if (!touchFilter.pass(msg.touch))
+            return false;
+        touchRing.push(index, msg.touch, readySince);
+    }
+    return true;
+}
+
+/*
+ * The read of ReadTrigger::DATA_READY, from the data ready handler. While
+ * loop() is in pollSensors() or waits for command responses, the frame is
+ * left flagged for pollSensors() instead; the sensor only has one reader at
+ * a time, and so have the fusion and the producer side of the ring.
+ */
+void readFromInterrupt(uint8_t index)
+{
+    Sensor &sensor = sensors[index];
+    if (producing || !sensor.present || !sensor.commands.IsIdle())
+        return;
+
+    MessageVariant msg;
+    unsigned long readySince;
+    if (serviceSensor(sensor, msg, readySince, true))
+        queueTouches(index, msg, readySince);
+}
+
+/*
+ * Producer side of the touch ring. Services the sensors round robin, reading
+ * at most one message of each: the search for a sensor with data ready or
+ * commands outstanding starts after the one that delivered the last message,
+ * so with all sensors streaming none waits for more than one read of each of
+ * the others. With several sensors the frames queued are the fused surface,
+ * see fusion. Returns the number of frames queued.
+ */
+uint8_t pollSensors()
+{
+    MessageVariant msg;
+    unsigned long readySince;
+    uint8_t queued = 0;
+    uint8_t first = lastServiced + 1;
+    producing = true;
+    for (uint8_t n = 0; n < nSensors; n++)
+    {
+        uint8_t i = (first + n) % nSensors;
+        if (!needsService(sensors[i]) || !serviceSensor(sensors[i], msg, readySince, false))
+            continue;
+
+        lastServiced = i;
+        if (queueTouches(i, msg, readySince))
+            queued++;
+    }
+    producing = false;
+    return queued;
+}
+
+/*
+ * Consumer side: moves the oldest queued frame into the touch registers and
+ * accounts for the time since its data ready edge.
+ *
+ * Every touch goes to its slot in touchSlots, reg_R_Touch + slot * 4. When a
+ * merged frame has two events for one slot, like the UP and the next DOWN of
+ * a finger, the rest of the frame waits for the next call, so no event is
+ * overwritten. Returns the number of slots written, see reg_R_ChangedSlots.
+ */
+uint8_t updateTouch()
+{
+    pollSensors();
+
+    if (slotNext >= slotRecord.frame.touchCount)
+    {
+        if (!touchRing.pop(slotRecord))
         {
-            auto size = ((TouchMessage *)touch)->touchCount;
-            nTouches = size >= TOUCH_BUFFER_SIZE ? TOUCH_BUFFER_SIZE : size;
-            for (uint8_t i = 0; i < nTouches; i++)
-            {
-                mapTouchdataToRegs(&((TouchMessage *)touch)->touchData[i], i);
-            }
-            zforce.DestroyMessage(touch);
-            return nTouches;
+            return 0;
         }
-        zforce.DestroyMessage(touch);
+        slotNext = 0;
+        setReg(reg_R_Sensor, slotRecord.sensor);
+
+        SensorStats &stats = sensors[slotRecord.sensor].stats;
+        unsigned long latency = micros() - slotRecord.readySince;
+        stats.registerFrames++;
+        stats.lastRegisterLatency = latency;
+        stats.totalRegisterLatency += latency;
+        if (latency > stats.maxRegisterLatency)
+            stats.maxRegisterLatency = latency;
+    }
+
+    uint8_t written = 0;
+    touchSlots.startUpdate();
+    for (; slotNext < slotRecord.frame.touchCount; slotNext++)
+    {
+        const TouchData &touch = slotRecord.frame.touchData[slotNext];
+        int8_t slot = touchSlots.place(touch);
+        if (slot == SLOT_WAIT)
+            break;
+        if (slot == SLOT_SKIP)
+            continue;
+        mapTouchdataToRegs(&touch, slot);
+        written++;
     }
-    return -1;
+
+    setReg(reg_R_ActiveSlots, touchSlots.getActive());
+    setReg(reg_R_ChangedSlots, touchSlots.getChanged());
+    return written;
 }
 
 void printTouchMessage()
 {
     TouchData touch;
-    for (size_t i = 0; i < nTouches; i++)
+    for (size_t i = 0; i < TOUCH_SLOTS; i++)
     {
+        if (!(touchSlots.getChanged() & (1 << i)))
+            continue;
         getTouchdataFromRegs(touch, i);
-        Serial << "(" << millis()/1000.0 << "s)\t(" << i << "/" << nTouches << ")\t["
+        Serial << "(" << millis()/1000.0 << "s)\t(" << i << "/" << TOUCH_SLOTS << ")\t["
                << touch.x << ", " << touch.y << "]\t("
                << touch.event << "/" << touch.id << ")\n";
     }
@@ -141,7 +594,7 @@ void printTouchMessage()
 
 void printOneReg(sensor_reg_t addr)
 {
-    Serial << "regs[" << addr << "] = " << _HEX(regs[addr]) << endl;
+    Serial << "regs[" << addr << "] = " << _HEX(loadReg(addr)) << endl;
 }
 
 void printRegs()
@@ -152,34 +605,83 @@ void printRegs()
     Serial << "-------------------------" << endl;
 }
 
-SensorReg_t decode(String input)
+void setSerialProtocol(SerialProtocol protocol)
 {
-    int commaIndexes[4];
-    String params[4];
-    size_t nParams = 4;
-    SensorReg_t reg = {0, 0};
+    serialProtocol = protocol;
+    commandLine.clear();
+    frameReader.clear();
+}
+
+SerialProtocol getSerialProtocol() { return serialProtocol; }
 
-    for (size_t i = 0; i < 4; i++)
+/*
+ * Takes the bytes the stream has received so far and runs the commands or
+ * frames they complete; never waits for more. Frame replies and telemetry go
+ * out on the stream through txQueue, as far as it takes them without waiting.
+ * Returns the number of commands and frames run.
+ */
+uint8_t pollSerial(Stream &stream)
+{
+    uint8_t ran = 0;
+    unsigned long now = millis();
+    for (int available = stream.available(); available > 0; available--)
     {
-        if (i == 0)
+        uint8_t c = stream.read();
+        if (serialProtocol == SerialProtocol::BINARY)
         {
-            commaIndexes[i] = input.indexOf(',');
-            params[i] = input.substring(0, commaIndexes[i]);
-            if (commaIndexes[i] == -1)
+            if (frameReader.feed(c))
             {
-                nParams = -1;
-                break;
+                uint8_t reply[FRAME_MAX_PAYLOAD];
+                queueFrame(TxPriority::TOUCH, reply, runFrame(frameReader.payload(), frameReader.length(), reply));
+                txQueue.drain(stream);
+                ran++;
             }
         }
-        else
+        else if (c == FRAME_DELIMITER)
         {
-            commaIndexes[i] = input.indexOf(',', commaIndexes[i - 1] + 1);
-            params[i] = input.substring(commaIndexes[i - 1] + 1, commaIndexes[i]);
-            if (commaIndexes[i] == -1)
-            {
-                nParams = i + 1;
-                break;
-            }
+            setSerialProtocol(SerialProtocol::BINARY);
+        }
+        else if (commandLine.feed((char)c, now))
+        {
+            runCommand(commandLine.line());
+            commandLine.clear();
+            ran++;
+        }
+    }
+    if (serialProtocol == SerialProtocol::TEXT && commandLine.expired(now))
+    {
+        runCommand(commandLine.line());
+        commandLine.clear();
+        ran++;
+    }
+    if (serialProtocol == SerialProtocol::BINARY)
+    {
+        pushChanges();
+        queuePendingRegs();
+    }
+    txQueue.drain(stream);
+    return ran;
+}
+
+/*
+ * Runs "addr,R" or "addr,W,val": fields are split at commas and numbers are
+ * read like String::toInt(). Anything but R with a value is a write. Either
+ * way the value the register holds afterwards is printed and returned, so a
+ * rejected write shows the old value after its error.
+ */
+SensorReg_t runCommand(const char *command)
+{
+    const char *params[3] = {command, nullptr, nullptr};
+    size_t nParams = 1;
+    SensorReg_t reg = {0, 0};
+
+    for (const char *c = command; *c != '\0' && nParams < 4; c++)
+    {
+        if (*c == ',')
+        {
+            if (nParams < 3)
+                params[nParams] = c + 1;
+            nParams++;
         }
     }
 
@@ -189,27 +691,301 @@ SensorReg_t decode(String input)
     }
     else
     {
-        reg.addr = params[0].toInt();
-        bool readOrWrite = params[1] == "R" ? 0 : 1;
+        reg.addr = atol(params[0]);
+        bool readOrWrite = params[1][0] == 'R' && (params[1][1] == ',' || params[1][1] == '\0') ? 0 : 1;
         if (nParams > 2 && readOrWrite == 1)    // write register
         {
-            reg.val = params[2].toInt();
-            if (reg.addr < MAX_REGS)
-                writeReg(reg.addr, reg.val);
-        }
-        else
-        {
-            if(reg.addr < MAX_REGS)
-                reg.val = regs[reg.addr];
+            sensor_val_t val = atol(params[2]);
+            if (!isWritable(reg.addr, val))
+                Serial << "Reg[" << reg.addr << "] = " << val << " rejected" << endl;
+            else if (!writeReg(reg.addr, val))
+                Serial << "Reg[" << reg.addr << "] = " << val << " not sent to the sensor" << endl;
         }
+        reg.val = readReg(reg.addr);
         Serial << "(" << millis()/1000.0 << "s)\tReg[" << reg.addr << "] = " << _HEX(reg.val) << endl;
     }
     return reg;
 }
 
-String encode(sensor_reg_t *regs, uint8_t length)
+// Little endian, the byte order of the frames.
+static void putValue(uint8_t *data, sensor_val_t value)
+{
+    for (uint8_t i = 0; i < 4; i++)
+        data[i] = (uint32_t)value >> (8 * i);
+}
+
+static sensor_val_t getValue(const uint8_t *data)
+{
+    return (sensor_val_t)((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+}
+
+static size_t replyError(uint8_t *reply, uint8_t command, FrameError error)
+{
+    reply[0] = (uint8_t)FrameCommand::ERROR;
+    reply[1] = command;
+    reply[2] = (uint8_t)error;
+    return 3;
+}
+
+/*
+ * Runs one request frame, see RegisterFrame.h, and returns the length of the
+ * reply payload, which needs FRAME_MAX_PAYLOAD bytes. A burst write stores
+ * all its registers before any of them is sent to the sensors, so a range
+ * like the active area goes out as one request with all its values.
+ */
+size_t runFrame(const uint8_t *payload, size_t length, uint8_t *reply)
+{
+    uint8_t command = length > 0 ? payload[0] : 0;
+
+    if (command == (uint8_t)FrameCommand::TEXT && length == 1)
+    {
+        reply[0] = command | (uint8_t)FrameCommand::REPLY;
+        setSerialProtocol(SerialProtocol::TEXT);
+        return 1;
+    }
+    if (command == (uint8_t)FrameCommand::UNSUBSCRIBE && (length == 1 || length == 3))
+    {
+        reply[0] = command | (uint8_t)FrameCommand::REPLY;
+        reply[1] = length == 1 ? unsubscribe() : unsubscribe(payload[1], payload[2]);
+        return 2;
+    }
+    if (command != (uint8_t)FrameCommand::READ && command != (uint8_t)FrameCommand::WRITE &&
+        command != (uint8_t)FrameCommand::SUBSCRIBE)
+    {
+        return replyError(reply, command, FrameError::COMMAND);
+    }
+    if (length < 3)
+    {
+        return replyError(reply, command, FrameError::LENGTH);
+    }
+
+    sensor_reg_t addr = payload[1];
+    uint8_t count = payload[2];
+    if (count == 0 || count > FRAME_MAX_REGS || addr + count > MAX_REGS)
+    {
+        return replyError(reply, command, FrameError::RANGE);
+    }
+
+    reply[0] = command | (uint8_t)FrameCommand::REPLY;
+    reply[1] = addr;
+    reply[2] = count;
+    if (command == (uint8_t)FrameCommand::SUBSCRIBE)
+    {
+        if (length != 5)
+            return replyError(reply, command, FrameError::LENGTH);
+        if (!subscribe(addr, count, payload[3] | (uint16_t)payload[4] << 8))
+            return replyError(reply, command, FrameError::FULL);
+        reply[3] = true;
+        return 4;
+    }
+    if (command == (uint8_t)FrameCommand::READ)
+    {
+        if (length != 3)
+        {
+            return replyError(reply, command, FrameError::LENGTH);
+        }
+        for (uint8_t i = 0; i < count; i++)
+            putValue(&reply[3 + i * 4], loadReg(addr + i));
+        return 3 + count * 4;
+    }
+
+    if (length != 3 + count * 4u)
+    {
+        return replyError(reply, command, FrameError::LENGTH);
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!isWritable(addr + i, getValue(&payload[3 + i * 4])))
+            return replyError(reply, command, FrameError::VALUE);
+    }
+    bool ok = true;
+    for (uint8_t i = 0; i < count; i++)
+        writeReg(addr + i, getValue(&payload[3 + i * 4]), false);
+    // Registers that share a handler, like the area, are applied together.
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (i == 0 || handlerOf(addr + i) != handlerOf(addr + i - 1))
+            ok = sendAndGetFromZforce(addr + i) && ok;
+    }
+    reply[3] = ok;
+    return 4;
+}
+
+bool queueFrame(TxPriority priority, const uint8_t *payload, size_t length)
+{
+    uint8_t encoded[FRAME_MAX_ENCODED + 1];
+    size_t size = encodeFrame(payload, length, encoded);
+    return size > 0 && txQueue.push(priority, encoded, size);
+}
+
+// One TOUCH frame with the slots written last, numbered so the host sees gaps.
+bool queueTouchFrame()
+{
+    uint8_t payload[4 + TOUCH_SLOTS * 6];
+    uint8_t count = 0;
+    payload[0] = (uint8_t)FrameCommand::TOUCH;
+    payload[1] = touchSequence++;
+    payload[2] = loadReg(reg_R_Sensor);
+    for (uint8_t slot = 0; slot < TOUCH_SLOTS; slot++)
+    {
+        if (!(touchSlots.getChanged() & (1 << slot)))
+            continue;
+        uint8_t *touch = &payload[4 + count++ * 6];
+        sensor_reg_t reg = reg_R_Touch + slot * 4;
+        sensor_val_t x = loadReg(reg + 0);
+        sensor_val_t y = loadReg(reg + 1);
+        touch[0] = x & 0xFF;
+        touch[1] = x >> 8;
+        touch[2] = y & 0xFF;
+        touch[3] = y >> 8;
+        touch[4] = loadReg(reg + 2);
+        touch[5] = loadReg(reg + 3);
+    }
+    payload[3] = count;
+    return queueFrame(TxPriority::TOUCH, payload, 4 + count * 6);
+}
+
+/*
+ * Starts pushing the changes of a range, all of its registers first. A range
+ * that is subscribed already gets the new interval.
+ */
+bool subscribe(sensor_reg_t addr, uint8_t count, uint16_t interval)
+{
+    if (count == 0 || count > FRAME_MAX_REGS || addr + count > MAX_REGS)
+        return false;
+
+    Subscription *slot = nullptr;
+    for (uint8_t i = 0; i < SUBSCRIPTION_MAX; i++)
+    {
+        Subscription &subscription = subscriptions[i];
+        if (subscription.count == count && subscription.addr == addr)
+        {
+            slot = &subscription;
+            break;
+        }
+        if (subscription.count == 0 && slot == nullptr)
+            slot = &subscription;
+    }
+    if (slot == nullptr)
+        return false;
+
+    slot->addr = addr;
+    slot->count = count;
+    slot->interval = interval;
+    slot->lastSent = millis() - interval;
+    slot->changed = (uint16_t)((1UL << count) - 1);
+    return true;
+}
+
+// Ends the subscriptions of exactly this range, or all of them with count 0.
+uint8_t unsubscribe(sensor_reg_t addr, uint8_t count)
+{
+    uint8_t removed = 0;
+    for (uint8_t i = 0; i < SUBSCRIPTION_MAX; i++)
+    {
+        Subscription &subscription = subscriptions[i];
+        if (subscription.count > 0 && (count == 0 || (subscription.addr == addr && subscription.count == count)))
+        {
+            subscription.count = 0;
+            subscription.changed = 0;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+/*
+ * Queues a NOTIFY frame for every subscription with changes whose interval
+ * has passed, from its first to its last changed register. Changes that do
+ * not fit the queue stay pending for the next call. Returns the number of
+ * frames queued.
+ */
+uint8_t pushChanges()
 {
+    uint8_t pushed = 0;
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < SUBSCRIPTION_MAX; i++)
+    {
+        Subscription &subscription = subscriptions[i];
+        if (subscription.changed == 0 || now - subscription.lastSent < subscription.interval)
+            continue;
+
+        uint8_t first = 0;
+        uint8_t last = subscription.count - 1;
+        while (!(subscription.changed & (1 << first)))
+            first++;
+        while (!(subscription.changed & (1 << last)))
+            last--;
+
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        uint8_t count = last - first + 1;
+        payload[0] = (uint8_t)FrameCommand::NOTIFY;
+        payload[1] = subscription.addr + first;
+        payload[2] = count;
+        for (uint8_t r = 0; r < count; r++)
+            putValue(&payload[3 + r * 4], loadReg(subscription.addr + first + r));
+        if (!queueFrame(TxPriority::TOUCH, payload, 3 + count * 4))
+            continue;
+
+        subscription.changed = 0;
+        subscription.lastSent = now;
+        pushed++;
+    }
+    return pushed;
+}
 
+/*
+ * Every register, as READ replies of up to FRAME_MAX_REGS registers each.
+ * Replies that do not fit the queue yet are left to pollSerial(), which
+ * queues them as it drains, so a dump larger than the queue still goes out
+ * whole. A dump that is still going on is not started again. Returns true
+ * once all of it is queued.
+ */
+bool queueRegs()
+{
+    if (regsCursor >= MAX_REGS)
+        regsCursor = 0;
+    return queuePendingRegs();
+}
+
+// Queues the rest of the dump queueRegs() started, as far as the queue takes it.
+bool queuePendingRegs()
+{
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    while (regsCursor < MAX_REGS && txQueue.room(TxPriority::DIAGNOSTIC) >= FRAME_MAX_ENCODED + 1)
+    {
+        sensor_reg_t addr = (sensor_reg_t)regsCursor;
+        uint8_t count = MAX_REGS - addr < FRAME_MAX_REGS ? MAX_REGS - addr : FRAME_MAX_REGS;
+        payload[0] = (uint8_t)FrameCommand::READ | (uint8_t)FrameCommand::REPLY;
+        payload[1] = addr;
+        payload[2] = count;
+        for (uint8_t i = 0; i < count; i++)
+            putValue(&payload[3 + i * 4], loadReg(addr + i));
+        queueFrame(TxPriority::DIAGNOSTIC, payload, 3 + count * 4);
+        regsCursor += count;
+    }
+    return regsCursor >= MAX_REGS;
+}
+
+SensorReg_t decode(String input)
+{
+    return runCommand(input.c_str());
+}
+
+// The registers as write commands, one per line, that set them again when sent back.
+String encode(sensor_reg_t *addrs, uint8_t length)
+{
+    String text;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (addrs[i] >= MAX_REGS)
+            continue;
+        text += String((int)addrs[i]);
+        text += ",W,";
+        text += String((long)loadReg(addrs[i]));
+        text += '\n';
+    }
+    return text;
 }
 
 }; // namespace SensorHelper
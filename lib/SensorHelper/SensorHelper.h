@@ -1,5 +1,13 @@
 #include <Arduino.h>
 #include "Zforce.h"
+#include "CommandQueue.h"
+#include "CommandLine.h"
+#include "RegisterFrame.h"
+#include "TxQueue.h"
+#include "TouchFusion.h"
+#include "TouchFilter.h"
+#include "TouchRing.h"
+#include "TouchSlots.h"
 #pragma once
 
 typedef uint8_t sensor_reg_t;
@@ -10,31 +18,140 @@ typedef struct SensorReg
     sensor_val_t val;
 } SensorReg_t;
 
+#ifndef TOUCH_SLOTS
+#define TOUCH_SLOTS MAX_REPORTED_TOUCHES // touches in the registers, the sensor's ReportedTouches and the fused touches
+#endif
+
 namespace SensorHelper
 {
 const sensor_reg_t reg_R_Status = 0x00;
 const sensor_reg_t reg_R_Bootcomplete = 0x01;
 const sensor_reg_t reg_RW_Enable = 0x02;
 const sensor_reg_t reg_RW_Frequency = 0x03;
+const sensor_reg_t reg_R_Sensor = 0x04; // sensor the touch registers were read from
+const sensor_reg_t reg_RW_ReadTrigger = 0x05; // a ReadTrigger value
 const sensor_reg_t reg_RW_Area = 0x06;
-const sensor_reg_t reg_R_Touch = 0x0A; // from 0x0A to 0x1A
+const sensor_reg_t reg_R_Touch = 0x0A; // x, y, id, event of TOUCH_SLOTS slots; a touch keeps its slot from DOWN to UP
+// The registers after the touch slots move with TOUCH_SLOTS.
+const unsigned regTouchEnd = reg_R_Touch + TOUCH_SLOTS * 4u;
+const sensor_reg_t reg_RW_DeadBandX = regTouchEnd; // MOVE frames within these are not reported
+const sensor_reg_t reg_RW_DeadBandY = regTouchEnd + 1;
+const sensor_reg_t reg_R_ActiveSlots = regTouchEnd + 2;  // bit per slot with a touch down
+const sensor_reg_t reg_R_ChangedSlots = regTouchEnd + 3; // bit per slot written by the last updateTouch()
+const unsigned regCount = regTouchEnd + 4;
+static_assert(regCount <= (sensor_reg_t)~0u + 1u, "the registers of TOUCH_SLOTS touches do not fit sensor_reg_t");
+
+#define SENSOR_MAX_SENSORS 4
+
+typedef struct SensorStats
+{
+    unsigned long frames;       // notifications read
+    unsigned long touchFrames;
+    unsigned long timedFrames;  // notifications read after data ready went high, the ones with a latency
+    unsigned long lastLatency;  // us from the data ready edge to the frame being read
+    unsigned long maxLatency;
+    unsigned long totalLatency; // over all timed frames, for the average
+    unsigned long registerFrames;       // touch frames that reached the touch registers
+    unsigned long lastRegisterLatency;  // us from the data ready edge to the touch registers
+    unsigned long maxRegisterLatency;
+    unsigned long totalRegisterLatency;
+} SensorStats;
+
+/*
+ * When frames are read. With LOOP, pollSensors() reads them, so a frame waits
+ * for the loop to come around. With DATA_READY the data ready interrupt reads
+ * the frame and queues its touches right away, unless loop() is using the
+ * sensor at that moment; loop() then only moves the frame into the registers.
+ * With the SERCOM DMA transport the handler runs once the DMAC has read the
+ * frame. The read blocks the interrupt for the bus time of one frame, so the
+ * transport has to read with interrupts disabled, as the I2C library and Wire
+ * on SAMD do.
+ */
+enum class ReadTrigger
+{
+    LOOP = 0,
+    DATA_READY = 1
+};
+
+// Sensors are added before begin(); without any, begin() uses zforce on PIN_NN_DR.
+bool addSensor(ZforceBase &sensor, uint32_t dataReadyPin);
+uint8_t sensorCount();
+bool isSensorPresent(uint8_t index);
+CommandQueue &commands(uint8_t index = 0);
+const SensorStats &sensorStats(uint8_t index);
+void resetSensorStats();
+
+// With more than one sensor, touches go through this before they reach the touch registers.
+// It reports TOUCH_SLOTS touches at most; further fingers count as fusion overflows.
+extern TouchFusion fusion;
+
+#ifndef TOUCH_RING_DEPTH
+#define TOUCH_RING_DEPTH 8 // frames of up to 10 touches each
+#endif
 
-void dataReadyISR();
-bool isDataReady();
-bool begin();
+// Touch frames read by pollSensors() wait here for updateTouch().
+extern TouchRing<TOUCH_RING_DEPTH> touchRing;
+
+// Holds back frames that moved less than reg_RW_DeadBandX/Y before they are queued.
+extern TouchFilter touchFilter;
+
+void setReadTrigger(ReadTrigger trigger);
+ReadTrigger getReadTrigger();
+
+// The touch register slot of every touch that is down.
+extern TouchSlots<TOUCH_SLOTS> touchSlots;
+
+bool isDataReady(uint8_t index = 0);
+bool begin(bool discover = false);
 void config(uint8_t index = 0);
+uint8_t pollSensors();
 uint8_t updateTouch();
+// False, changing nothing, for a read only register or a value out of its range; see regRows.
 bool writeReg(sensor_reg_t addr, sensor_val_t val, bool sendToZforce = true);
 // bool writeReg(SensorReg reg) { return writeReg(reg.addr, reg.val); }
 sensor_val_t readReg(sensor_reg_t addr);
 bool readReg(SensorReg_t &reg);
 bool sendAndGetFromZforce(sensor_reg_t addr);
-void mapTouchdataToRegs(TouchData *touch, uint8_t index);
+bool configure(const DeviceConfiguration &config);
+void flushCommands();
+void mapTouchdataToRegs(const TouchData *touch, uint8_t index);
 void getTouchdataFromRegs(TouchData &touch, uint8_t index);
 void printTouchMessage();
 void printOneReg(sensor_reg_t addr);
 void printRegs();
 
+/*
+ * Register access from the host, either as text commands, "addr,R" or
+ * "addr,W,val" one per line, or as binary frames, see RegisterFrame.h. A 0x00
+ * byte received in text mode switches to frames; the TEXT frame switches back.
+ */
+enum class SerialProtocol
+{
+    TEXT = 0,
+    BINARY = 1
+};
+
+extern CommandLine commandLine;
+extern FrameReader frameReader;
+void setSerialProtocol(SerialProtocol protocol);
+SerialProtocol getSerialProtocol();
+uint8_t pollSerial(Stream &stream = Serial);
+SensorReg_t runCommand(const char *command);
+size_t runFrame(const uint8_t *payload, size_t length, uint8_t *reply);
+
+// Binary telemetry, sent by pollSerial() without blocking; see RegisterFrame.h.
+extern TxQueue txQueue;
+bool queueFrame(TxPriority priority, const uint8_t *payload, size_t length);
+bool queueTouchFrame();
+bool queueRegs();
+bool queuePendingRegs();
+
+#define SUBSCRIPTION_MAX 4
+
+// Register ranges, of up to FRAME_MAX_REGS, whose changes are pushed as NOTIFY frames.
+bool subscribe(sensor_reg_t addr, uint8_t count, uint16_t interval);
+uint8_t unsubscribe(sensor_reg_t addr = 0, uint8_t count = 0);
+uint8_t pushChanges();
 SensorReg_t decode(String str);
 String encode(sensor_reg_t *regs, uint8_t length);
 }; // namespace SensorHelper
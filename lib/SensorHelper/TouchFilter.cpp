@@ -0,0 +1,58 @@
+#include "TouchFilter.h"
+
+TouchFilter::TouchFilter() : deadBandX(0), deadBandY(0)
+{
+    reset();
+    resetStats();
+}
+
+void TouchFilter::setDeadBand(uint16_t x, uint16_t y)
+{
+    deadBandX = x;
+    deadBandY = y;
+}
+
+void TouchFilter::reset()
+{
+    memset(reported, 0, sizeof(reported));
+}
+
+// Also true for a touch without a reference, e.g. one that went DOWN before the filter was set.
+bool TouchFilter::moved(const TouchData &touch) const
+{
+    if (touch.event != MOVE || touch.id >= FILTER_MAX_IDS || !reported[touch.id].down)
+        return true;
+
+    const Reported &last = reported[touch.id];
+    uint16_t dx = touch.x > last.x ? touch.x - last.x : last.x - touch.x;
+    uint16_t dy = touch.y > last.y ? touch.y - last.y : last.y - touch.y;
+    return dx > deadBandX || dy > deadBandY;
+}
+
+bool TouchFilter::pass(const TouchFrame &frame)
+{
+    stats.frames++;
+    if (deadBandX != 0 || deadBandY != 0)
+    {
+        bool changed = false;
+        for (uint8_t i = 0; i < frame.touchCount && !changed; i++)
+            changed = moved(frame.touchData[i]);
+        if (!changed)
+        {
+            stats.suppressed++;
+            return false;
+        }
+    }
+
+    for (uint8_t i = 0; i < frame.touchCount; i++)
+    {
+        const TouchData &touch = frame.touchData[i];
+        if (touch.id >= FILTER_MAX_IDS)
+            continue;
+        Reported &last = reported[touch.id];
+        last.down = touch.event != UP;
+        last.x = touch.x;
+        last.y = touch.y;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include "Zforce.h"
+
+#define FILTER_MAX_IDS MAX_REPORTED_TOUCHES // touch ids tracked; others always pass
+
+typedef struct FilterStats
+{
+    unsigned long frames;
+    unsigned long suppressed; // MOVE frames that stayed within the dead-band
+} FilterStats;
+
+/*
+ * Drops touch frames that only report movement within a dead-band. Each touch
+ * is compared against the position last passed on for its id; a frame passes
+ * if any of its touches went DOWN or UP or moved by more than the dead-band
+ * on either axis, and then all its positions become the new reference. With
+ * both dead-bands 0, the default, every frame passes.
+ */
+class TouchFilter
+{
+public:
+    TouchFilter();
+
+    void setDeadBand(uint16_t x, uint16_t y);
+    uint16_t getDeadBandX() const { return deadBandX; }
+    uint16_t getDeadBandY() const { return deadBandY; }
+    void reset();
+
+    // True if the frame is to be reported.
+    bool pass(const TouchFrame &frame);
+
+    const FilterStats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    typedef struct Reported
+    {
+        bool down;
+        uint16_t x;
+        uint16_t y;
+    } Reported;
+
+    bool moved(const TouchData &touch) const;
+
+    Reported reported[FILTER_MAX_IDS];
+    uint16_t deadBandX;
+    uint16_t deadBandY;
+    FilterStats stats;
+};
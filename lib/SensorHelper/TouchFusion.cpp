@@ -0,0 +1,206 @@
+#include "TouchFusion.h"
+#include <math.h>
+
+TouchFusion::TouchFusion(uint8_t maxTouches)
+    : maxTouches(maxTouches < 1 ? 1 : (maxTouches > FUSION_MAX_TOUCHES ? FUSION_MAX_TOUCHES : maxTouches)),
+      mergeDistance(FUSION_DEFAULT_MERGE_DISTANCE)
+{
+    for (uint8_t i = 0; i < FUSION_MAX_SENSORS; i++)
+        transforms[i] = makeTransform(0, 0, 0);
+    reset();
+    resetStats();
+}
+
+SensorTransform TouchFusion::makeTransform(int32_t offsetX, int32_t offsetY, int16_t rotation, int32_t scale)
+{
+    SensorTransform transform;
+    if (scale > FUSION_MAX_SCALE || scale < -FUSION_MAX_SCALE)
+        scale = scale > 0 ? FUSION_MAX_SCALE : -FUSION_MAX_SCALE; // cos and sin times it still fit m
+    float angle = rotation * (float)M_PI / 180.0f;
+    float c = cosf(angle) * scale;
+    float s = sinf(angle) * scale;
+    transform.offsetX = offsetX;
+    transform.offsetY = offsetY;
+    transform.m[0] = (int16_t)lroundf(c);
+    transform.m[1] = (int16_t)lroundf(-s);
+    transform.m[2] = (int16_t)lroundf(s);
+    transform.m[3] = (int16_t)lroundf(c);
+    return transform;
+}
+
+void TouchFusion::setTransform(uint8_t sensor, const SensorTransform &transform)
+{
+    if (sensor < FUSION_MAX_SENSORS)
+        transforms[sensor] = transform;
+}
+
+void TouchFusion::reset()
+{
+    memset(slots, 0, sizeof(slots));
+}
+
+// Each product fits 32 bits, so the terms are shifted before they are added.
+void TouchFusion::map(uint8_t sensor, const TouchData &touch, uint16_t &x, uint16_t &y) const
+{
+    const SensorTransform &t = transforms[sensor];
+    int32_t fx = t.offsetX + ((int32_t)t.m[0] * touch.x >> FUSION_SHIFT) + ((int32_t)t.m[1] * touch.y >> FUSION_SHIFT);
+    int32_t fy = t.offsetY + ((int32_t)t.m[2] * touch.x >> FUSION_SHIFT) + ((int32_t)t.m[3] * touch.y >> FUSION_SHIFT);
+    x = fx < 0 ? 0 : (fx > 0xFFFF ? 0xFFFF : fx);
+    y = fy < 0 ? 0 : (fy > 0xFFFF ? 0xFFFF : fy);
+}
+
+int8_t TouchFusion::find(uint8_t sensor, uint8_t id) const
+{
+    for (uint8_t i = 0; i < FUSION_MAX_TOUCHES; i++)
+    {
+        const Slot &slot = slots[i];
+        if (slot.active && (slot.sources & (1 << sensor)) && slot.sourceIds[sensor] == id)
+            return i;
+    }
+    return -1;
+}
+
+// The closest touch within the merge distance that this sensor does not see yet.
+int8_t TouchFusion::findNear(uint8_t sensor, uint16_t x, uint16_t y) const
+{
+    int8_t nearest = -1;
+    uint16_t nearestDistance = mergeDistance;
+    for (uint8_t i = 0; i < FUSION_MAX_TOUCHES; i++)
+    {
+        const Slot &slot = slots[i];
+        if (!slot.active || slot.sources == 0 || (slot.sources & (1 << sensor)))
+            continue;
+        uint16_t dx = x > slot.x ? x - slot.x : slot.x - x;
+        uint16_t dy = y > slot.y ? y - slot.y : slot.y - y;
+        uint16_t distance = dx > dy ? dx : dy;
+        if (distance <= nearestDistance)
+        {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+// The lowest free logical id, so ids stay small like the sensor's own.
+int8_t TouchFusion::allocate()
+{
+    for (uint8_t i = 0; i < maxTouches; i++)
+    {
+        Slot &slot = slots[i];
+        if (!slot.active)
+        {
+            memset(&slot, 0, sizeof(slot));
+            slot.active = true;
+            slot.event = DOWN;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The touch goes UP once no sensor sees it anymore.
+void TouchFusion::release(Slot &slot, uint8_t sensor)
+{
+    slot.sources &= ~(1 << sensor);
+    if (slot.sources == 0)
+        slot.event = UP;
+}
+
+uint8_t TouchFusion::fuse(uint8_t sensor, const TouchFrame &in, TouchFrame &out)
+{
+    unsigned long start = micros();
+    out.touchCount = 0;
+    if (sensor >= FUSION_MAX_SENSORS)
+        return 0;
+
+    // Touches reported UP last time are gone; the others have no news yet.
+    for (uint8_t i = 0; i < FUSION_MAX_TOUCHES; i++)
+    {
+        Slot &slot = slots[i];
+        if (slot.active && slot.event == UP)
+            slot.active = false;
+        else if (slot.active)
+            slot.event = MOVE;
+    }
+
+    uint16_t seen = 0;
+    uint8_t count = in.touchCount > MAX_REPORTED_TOUCHES ? MAX_REPORTED_TOUCHES : in.touchCount;
+    for (uint8_t t = 0; t < count; t++)
+    {
+        const TouchData &touch = in.touchData[t];
+        if (touch.event != DOWN && touch.event != MOVE && touch.event != UP)
+            continue;
+
+        uint16_t x, y;
+        map(sensor, touch, x, y);
+        int8_t index = find(sensor, touch.id);
+        if (index < 0 && touch.event != UP)
+        {
+            index = findNear(sensor, x, y);
+            if (index >= 0)
+                stats.merges++;
+            else if ((index = allocate()) < 0)
+                stats.overflows++;
+        }
+        if (index < 0)
+            continue;
+
+        Slot &slot = slots[index];
+        seen |= 1 << index;
+        slot.sources |= 1 << sensor;
+        slot.sourceIds[sensor] = touch.id;
+        slot.sourceX[sensor] = x;
+        slot.sourceY[sensor] = y;
+        if (touch.event == UP)
+            release(slot, sensor);
+    }
+
+    // A touch this sensor no longer reports has gone up without telling.
+    uint16_t changed = seen;
+    for (uint8_t i = 0; i < FUSION_MAX_TOUCHES; i++)
+    {
+        Slot &slot = slots[i];
+        if (slot.active && (slot.sources & (1 << sensor)) && !(seen & (1 << i)))
+        {
+            release(slot, sensor);
+            changed |= 1 << i;
+        }
+    }
+
+    // Only the touches of this sensor's frame; the others have no news.
+    for (uint8_t i = 0; i < FUSION_MAX_TOUCHES; i++)
+    {
+        Slot &slot = slots[i];
+        if (!slot.active || !(changed & (1 << i)))
+            continue;
+        if (slot.sources != 0)
+        {
+            uint32_t sumX = 0, sumY = 0;
+            uint8_t n = 0;
+            for (uint8_t s = 0; s < FUSION_MAX_SENSORS; s++)
+            {
+                if (slot.sources & (1 << s))
+                {
+                    sumX += slot.sourceX[s];
+                    sumY += slot.sourceY[s];
+                    n++;
+                }
+            }
+            slot.x = sumX / n;
+            slot.y = sumY / n;
+        }
+        TouchData &touch = out.touchData[out.touchCount++];
+        touch.x = slot.x;
+        touch.y = slot.y;
+        touch.id = i;
+        touch.event = slot.event;
+    }
+
+    unsigned long elapsed = micros() - start;
+    stats.frames++;
+    stats.lastMicros = elapsed;
+    if (elapsed > stats.maxMicros)
+        stats.maxMicros = elapsed;
+    return out.touchCount;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+#include "Zforce.h"
+
+#define FUSION_MAX_SENSORS 4
+#define FUSION_MAX_TOUCHES MAX_REPORTED_TOUCHES
+#define FUSION_SHIFT 12                    // fraction bits of the transform matrix
+#define FUSION_ONE (1 << FUSION_SHIFT)     // scale 1.0
+#define FUSION_MAX_SCALE 32767             // just under 8.0, the most an int16_t matrix element holds
+#define FUSION_DEFAULT_MERGE_DISTANCE 100  // in fused coordinates
+
+/*
+ * Maps sensor coordinates to the fused surface:
+ *   X = offsetX + (m[0] * x + m[1] * y) >> FUSION_SHIFT
+ *   Y = offsetY + (m[2] * x + m[3] * y) >> FUSION_SHIFT
+ * where m is the rotation times the scale.
+ */
+typedef struct SensorTransform
+{
+    int32_t offsetX;
+    int32_t offsetY;
+    int16_t m[4];
+} SensorTransform;
+
+typedef struct FusionStats
+{
+    unsigned long frames;
+    unsigned long merges;   // touches of one sensor joined to a touch of another
+    unsigned long overflows; // touches dropped because all maxTouches logical ids were taken
+    unsigned long lastMicros;
+    unsigned long maxMicros;
+} FusionStats;
+
+/*
+ * Merges the touch frames of several sensors into one touch surface. Every
+ * touch is mapped through the transform of its sensor; a touch that goes DOWN
+ * within the merge distance of a touch of another sensor is taken for the
+ * same finger seen in an overlap zone, and both are reported as one touch at
+ * the average position. Touches get logical ids that hold across sensors for
+ * as long as any sensor sees the finger. At most maxTouches of them are
+ * reported at once, so the fused frame fits a consumer with fewer slots.
+ *
+ * All arithmetic is 32 bit fixed point and a frame costs at most
+ * MAX_REPORTED_TOUCHES * FUSION_MAX_TOUCHES comparisons.
+ */
+class TouchFusion
+{
+public:
+    TouchFusion(uint8_t maxTouches = FUSION_MAX_TOUCHES);
+
+    // rotation in degrees, scale in FUSION_ONE units and clamped to +-FUSION_MAX_SCALE;
+    // computed once here, not per frame.
+    static SensorTransform makeTransform(int32_t offsetX, int32_t offsetY, int16_t rotation, int32_t scale = FUSION_ONE);
+
+    void setTransform(uint8_t sensor, const SensorTransform &transform);
+    void setMergeDistance(uint16_t distance) { mergeDistance = distance; }
+    void reset();
+
+    // Takes the frame of one sensor; out gets the logical touches it moved, put down or lifted.
+    uint8_t fuse(uint8_t sensor, const TouchFrame &in, TouchFrame &out);
+
+    const FusionStats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    typedef struct Slot
+    {
+        bool active;
+        TouchEvent event;
+        uint8_t sources; // bit per sensor seeing the touch
+        uint8_t sourceIds[FUSION_MAX_SENSORS];
+        uint16_t sourceX[FUSION_MAX_SENSORS];
+        uint16_t sourceY[FUSION_MAX_SENSORS];
+        uint16_t x;
+        uint16_t y;
+    } Slot;
+
+    void map(uint8_t sensor, const TouchData &touch, uint16_t &x, uint16_t &y) const;
+    int8_t find(uint8_t sensor, uint8_t id) const;
+    int8_t findNear(uint8_t sensor, uint16_t x, uint16_t y) const;
+    int8_t allocate();
+    void release(Slot &slot, uint8_t sensor);
+
+    SensorTransform transforms[FUSION_MAX_SENSORS];
+    Slot slots[FUSION_MAX_TOUCHES];
+    uint8_t maxTouches; // logical ids in use, from 1 to FUSION_MAX_TOUCHES
+    uint16_t mergeDistance;
+    FusionStats stats;
+};
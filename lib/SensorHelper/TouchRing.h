@@ -0,0 +1,190 @@
+#pragma once
+#include <Arduino.h>
+#include "Zforce.h"
+
+// What push() does with a frame that finds the ring full, or just not empty.
+enum class RingPolicy
+{
+    DROP_OLDEST = 0, // overwrite the oldest frame when full
+    COALESCE = 1,    // when full, merge it into the newest frame, keeping every DOWN and UP
+    LATEST = 2       // like COALESCE, and merge already once a frame waits behind the one being read
+};
+
+typedef struct TouchRecord
+{
+    uint8_t sensor;
+    unsigned long readySince; // micros() of the data ready edge of the oldest frame merged in here
+    TouchFrame frame;
+} TouchRecord;
+
+typedef struct TouchRingStats
+{
+    unsigned long pushed;
+    unsigned long coalesced;  // frames merged into the newest queued frame
+    unsigned long mergedMoves; // MOVE events of those that replaced an older position
+    unsigned long dropped;    // frames overwritten before they were read
+    unsigned long lostEvents; // DOWN and UP events in the dropped frames
+    uint8_t maxLevel;
+} TouchRingStats;
+
+/*
+ * Single producer, single consumer ring of decoded touch frames. The producer
+ * (the data ready path, possibly an interrupt) only writes head, the consumer
+ * (the loop) only writes tail, so neither side locks. Both are 8 bit and
+ * therefore read atomically on every MCU.
+ *
+ * The producer is assumed not to be interrupted by the consumer, which holds
+ * for an interrupt handler on a single core. The oldest frame may be the one
+ * the consumer is copying, so LATEST only merges into a frame behind it: with
+ * a slow consumer at most two frames wait, the one due next and one with the
+ * latest position of every touch. A DROP_OLDEST producer may then
+ * overwrite the frame the consumer is copying; pop() notices and takes the
+ * next one. The consumer has to pop at least once every 256 - Depth frames
+ * for the drop accounting to stay exact.
+ */
+template <uint8_t Depth>
+class TouchRing
+{
+    static_assert(Depth >= 2 && Depth <= 128 && (Depth & (Depth - 1)) == 0, "Depth must be a power of two from 2 to 128");
+
+public:
+    TouchRing() : head(0), tail(0), policy(RingPolicy::LATEST) { memset(&stats, 0, sizeof(stats)); }
+
+    void setPolicy(RingPolicy policy) { this->policy = policy; }
+    RingPolicy getPolicy() const { return policy; }
+
+    // Producer side. Returns false if a frame had to be dropped.
+    bool push(uint8_t sensor, const TouchFrame &frame, unsigned long readySince)
+    {
+        uint8_t h = head;
+        uint8_t level = h - tail;
+        stats.pushed++;
+        if (level >= Depth || (policy == RingPolicy::LATEST && level >= 2))
+        {
+            uint8_t moves = 0;
+            if (policy != RingPolicy::DROP_OLDEST && coalesce(records[(h - 1) & (Depth - 1)], sensor, frame, moves))
+            {
+                stats.coalesced++;
+                stats.mergedMoves += moves;
+                return true;
+            }
+        }
+        if (level >= Depth)
+        {
+            stats.dropped++;
+            stats.lostEvents += countEdges(records[h & (Depth - 1)].frame);
+        }
+
+        TouchRecord &record = records[h & (Depth - 1)];
+        record.sensor = sensor;
+        record.readySince = readySince;
+        record.frame.touchCount = frame.touchCount;
+        memcpy(record.frame.touchData, frame.touchData, frame.touchCount * sizeof(TouchData));
+        __asm__ __volatile__("" ::: "memory"); // the frame is complete before it is published
+        head = h + 1;
+
+        uint8_t newLevel = level < Depth ? level + 1 : Depth;
+        if (newLevel > stats.maxLevel)
+            stats.maxLevel = newLevel;
+        return level < Depth;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(TouchRecord &record)
+    {
+        for (;;)
+        {
+            uint8_t h = head;
+            if (h == tail)
+                return false;
+            if ((uint8_t)(h - tail) > Depth)
+                tail = h - Depth; // the older ones were overwritten
+
+            const TouchRecord &source = records[tail & (Depth - 1)];
+            record.sensor = source.sensor;
+            record.readySince = source.readySince;
+            record.frame.touchCount = source.frame.touchCount;
+            memcpy(record.frame.touchData, source.frame.touchData, source.frame.touchCount * sizeof(TouchData));
+            __asm__ __volatile__("" ::: "memory");
+            if ((uint8_t)(head - tail) <= Depth)
+            {
+                tail = tail + 1;
+                return true;
+            }
+        }
+    }
+
+    uint8_t level() const
+    {
+        uint8_t level = head - tail;
+        return level > Depth ? Depth : level;
+    }
+
+    void clear() { tail = head; }
+
+    const TouchRingStats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    static uint8_t countEdges(const TouchFrame &frame)
+    {
+        uint8_t edges = 0;
+        for (uint8_t i = 0; i < frame.touchCount; i++)
+            edges += frame.touchData[i].event == DOWN || frame.touchData[i].event == UP;
+        return edges;
+    }
+
+    /*
+     * Merges frame into the newest queued record, touch by touch: a MOVE
+     * updates the last entry of its id, and an UP replaces a MOVE. Anything
+     * else, like the UP of a touch that went DOWN in the queued frame, is
+     * added as an entry of its own. Returns false, changing nothing, if the
+     * result would not fit a frame. Touch ids are those of one surface, either
+     * of the only sensor or fused. moves counts the MOVEs merged into an entry.
+     */
+    static bool coalesce(TouchRecord &record, uint8_t sensor, const TouchFrame &frame, uint8_t &moves)
+    {
+        TouchFrame merged = record.frame;
+        for (uint8_t i = 0; i < frame.touchCount; i++)
+        {
+            const TouchData &touch = frame.touchData[i];
+            int8_t last = -1;
+            for (uint8_t j = 0; j < merged.touchCount; j++)
+            {
+                if (merged.touchData[j].id == touch.id)
+                    last = j;
+            }
+
+            if (last >= 0)
+            {
+                TouchData &queued = merged.touchData[last];
+                if (touch.event == MOVE && queued.event != UP)
+                {
+                    TouchEvent event = queued.event; // a DOWN stays a DOWN, at the new position
+                    queued = touch;
+                    queued.event = event;
+                    moves++;
+                    continue;
+                }
+                if (touch.event == UP && queued.event == MOVE)
+                {
+                    queued = touch;
+                    continue;
+                }
+            }
+            if (merged.touchCount == MAX_REPORTED_TOUCHES)
+                return false;
+            merged.touchData[merged.touchCount++] = touch;
+        }
+
+        record.sensor = sensor;
+        record.frame = merged;
+        return true;
+    }
+
+    TouchRecord records[Depth];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    RingPolicy policy;
+    TouchRingStats stats;
+};
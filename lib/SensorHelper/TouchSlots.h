@@ -0,0 +1,108 @@
+#pragma once
+#include <Arduino.h>
+#include "Zforce.h"
+
+#define SLOT_SKIP -1 // place(): the touch gets no slot and is dropped
+#define SLOT_WAIT -2 // place(): the touch has to wait for the next update
+
+typedef struct TouchSlotStats
+{
+    unsigned long deferred;  // updates that left touches for the next one to keep every event
+    unsigned long overflows; // touches dropped as all slots were taken
+    unsigned long orphans;   // UPs of touches without a slot
+} TouchSlotStats;
+
+/*
+ * Which touch is in which of Capacity register slots, keyed by TouchData::id
+ * like the Linux MT protocol B. A touch gets the lowest free slot on its first
+ * event and keeps it until its UP, the last event written to the slot. Within
+ * one update every slot takes one event at most, so an UP and the next DOWN of
+ * an id are never seen in the wrong order.
+ */
+template <uint8_t Capacity>
+class TouchSlots
+{
+    static_assert(Capacity >= 1 && Capacity <= MAX_REPORTED_TOUCHES, "Capacity must be from 1 to MAX_REPORTED_TOUCHES");
+
+public:
+    typedef uint16_t Mask; // bit per slot
+    static_assert(Capacity <= sizeof(Mask) * 8, "Mask has a bit per slot");
+
+    static constexpr uint8_t capacity = Capacity;
+
+    TouchSlots() : active(0), changed(0) { memset(&stats, 0, sizeof(stats)); }
+
+    void startUpdate() { changed = 0; }
+
+    // The slot the touch goes to, SLOT_SKIP or SLOT_WAIT.
+    int8_t place(const TouchData &touch)
+    {
+        int8_t slot = find(touch.id, active | changed);
+        if (slot < 0 && touch.event == UP)
+        {
+            stats.orphans++; // its DOWN never made it into a slot
+            return SLOT_SKIP;
+        }
+        if (slot < 0)
+        {
+            slot = findFree(active | changed);
+            if (slot < 0 && findFree(active) >= 0)
+                return wait();
+            if (slot < 0)
+            {
+                stats.overflows++;
+                return SLOT_SKIP;
+            }
+        }
+        else if (changed & (1 << slot))
+        {
+            return wait(); // also a DOWN after an UP of its id, so it is not seen first
+        }
+
+        changed |= 1 << slot;
+        ids[slot] = touch.id;
+        if (touch.event == UP)
+            active &= ~(1 << slot);
+        else
+            active |= 1 << slot;
+        return slot;
+    }
+
+    Mask getActive() const { return active; }
+    Mask getChanged() const { return changed; }
+
+    const TouchSlotStats &getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+    int8_t find(uint8_t id, Mask mask) const
+    {
+        for (uint8_t slot = 0; slot < Capacity; slot++)
+        {
+            if ((mask & (1 << slot)) && ids[slot] == id)
+                return slot;
+        }
+        return -1;
+    }
+
+    static int8_t findFree(Mask taken)
+    {
+        for (uint8_t slot = 0; slot < Capacity; slot++)
+        {
+            if (!(taken & (1 << slot)))
+                return slot;
+        }
+        return -1;
+    }
+
+    int8_t wait()
+    {
+        stats.deferred++;
+        return SLOT_WAIT;
+    }
+
+    Mask active;
+    Mask changed; // slots written since startUpdate()
+    uint8_t ids[Capacity];
+    TouchSlotStats stats;
+};
@@ -0,0 +1,97 @@
+#include "TxQueue.h"
+
+TxQueue::TxQueue()
+{
+    clear();
+    resetStats();
+}
+
+bool TxQueue::push(TxPriority priority, const uint8_t *data, uint8_t length)
+{
+    Ring &ring = rings[(uint8_t)priority];
+    TxQueueStats &stat = stats[(uint8_t)priority];
+    uint16_t level = ring.head - ring.tail;
+    if (length == 0 || level + 1 + length > TX_QUEUE_SIZE)
+    {
+        stat.dropped++;
+        stat.droppedBytes += length;
+        return false;
+    }
+
+    ring.data[ring.head++ & (TX_QUEUE_SIZE - 1)] = length;
+    for (uint8_t i = 0; i < length; i++)
+        ring.data[ring.head++ & (TX_QUEUE_SIZE - 1)] = data[i];
+
+    stat.frames++;
+    stat.bytes += length;
+    level += 1 + length;
+    if (level > stat.maxLevel)
+        stat.maxLevel = level;
+    return true;
+}
+
+uint16_t TxQueue::room(TxPriority priority) const
+{
+    const Ring &ring = rings[(uint8_t)priority];
+    uint16_t level = ring.head - ring.tail;
+    return level + 1 < TX_QUEUE_SIZE ? TX_QUEUE_SIZE - level - 1 : 0;
+}
+
+size_t TxQueue::drain(Print &out)
+{
+    size_t written = 0;
+    int room = out.availableForWrite();
+    while (room > 0)
+    {
+        if (remaining == 0)
+        {
+            sending = -1;
+            for (uint8_t p = 0; p < TX_PRIORITIES; p++)
+            {
+                Ring &ring = rings[p];
+                if (ring.head != ring.tail)
+                {
+                    sending = p;
+                    remaining = ring.data[ring.tail++ & (TX_QUEUE_SIZE - 1)];
+                    break;
+                }
+            }
+            if (sending < 0)
+                break;
+        }
+
+        // Up to the end of the frame, of the room in the port or of the buffer, whichever comes first.
+        Ring &ring = rings[sending];
+        uint16_t offset = ring.tail & (TX_QUEUE_SIZE - 1);
+        size_t chunk = remaining;
+        if (chunk > (size_t)room)
+            chunk = room;
+        if (chunk > (size_t)(TX_QUEUE_SIZE - offset))
+            chunk = TX_QUEUE_SIZE - offset;
+        out.write(&ring.data[offset], chunk);
+        ring.tail += chunk;
+        remaining -= chunk;
+        room -= chunk;
+        written += chunk;
+    }
+    return written;
+}
+
+bool TxQueue::empty() const
+{
+    for (uint8_t p = 0; p < TX_PRIORITIES; p++)
+    {
+        if (rings[p].head != rings[p].tail)
+            return false;
+    }
+    return true;
+}
+
+// A frame being written is cut short, the host resynchronises on the next delimiter.
+void TxQueue::clear()
+{
+    for (uint8_t p = 0; p < TX_PRIORITIES; p++)
+        rings[p].head = rings[p].tail = 0;
+    sending = -1;
+    remaining = 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+
+#ifndef TX_QUEUE_SIZE
+#if defined(__AVR__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega8__) || defined(__AVR_ATmega328P__)
+#define TX_QUEUE_SIZE 128 // bytes per priority, a power of two
+#else
+#define TX_QUEUE_SIZE 256
+#endif
+#endif
+
+// Frames of a higher priority go out first; the order within one is kept.
+enum class TxPriority
+{
+    TOUCH = 0,     // touch frames and replies
+    DIAGNOSTIC = 1 // register dumps and the like
+};
+#define TX_PRIORITIES 2
+
+typedef struct TxQueueStats
+{
+    unsigned long frames;
+    unsigned long bytes;
+    unsigned long dropped;      // frames that did not fit
+    unsigned long droppedBytes;
+    uint16_t maxLevel;          // bytes
+} TxQueueStats;
+
+/*
+ * Outgoing serial data, queued as whole frames so that the loop never waits
+ * for the port. drain() writes only what availableForWrite() says the port
+ * takes right now and always finishes a frame before it starts the next, so
+ * frames never interleave on the wire. A frame that finds its queue full is
+ * dropped and counted; nothing that is queued is ever overwritten.
+ */
+class TxQueue
+{
+    static_assert(TX_QUEUE_SIZE >= 128 && TX_QUEUE_SIZE <= 4096 && (TX_QUEUE_SIZE & (TX_QUEUE_SIZE - 1)) == 0,
+                  "TX_QUEUE_SIZE must be a power of two from 128 to 4096");
+
+public:
+    TxQueue();
+
+    // Queues all of data or nothing; false if the frame was dropped.
+    bool push(TxPriority priority, const uint8_t *data, uint8_t length);
+    // The longest frame push() takes for this priority right now.
+    uint16_t room(TxPriority priority) const;
+    // Returns the number of bytes written.
+    size_t drain(Print &out);
+    bool empty() const;
+    void clear();
+
+    const TxQueueStats &getStats(TxPriority priority) const { return stats[(uint8_t)priority]; }
+    void resetStats() { memset(stats, 0, sizeof(stats)); }
+
+private:
+    // Every frame is stored as its length byte followed by the frame.
+    typedef struct Ring
+    {
+        uint8_t data[TX_QUEUE_SIZE];
+        uint16_t head;
+        uint16_t tail;
+    } Ring;
+
+    Ring rings[TX_PRIORITIES];
+    int8_t sending;    // the ring of the frame being written, -1 between frames
+    uint8_t remaining; // bytes of that frame still to write
+    TxQueueStats stats[TX_PRIORITIES];
+};
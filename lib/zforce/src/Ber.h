@@ -0,0 +1,132 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+
+/*
+ * A single BER tag-length-value element. The value points into the buffer
+ * that was decoded, nothing is copied.
+ */
+typedef struct BerTlv
+{
+	uint8_t tag;
+	uint8_t length;
+	const uint8_t* value;
+} BerTlv;
+
+/*
+ * Walks the BER elements of a buffer, or the children of a constructed
+ * element, one at a time. Every length is checked against the enclosing
+ * element, so a malformed frame stops the walk instead of reading past it.
+ */
+class BerReader
+{
+    public:
+		BerReader(const uint8_t* data, uint8_t length);
+		BerReader(const BerTlv& constructed);
+		bool Next(BerTlv& tlv);
+		bool AtEnd() const { return cursor == end; }
+		bool IsMalformed() const { return malformed; }
+    private:
+		const uint8_t* cursor;
+		const uint8_t* end;
+		bool malformed;
+};
+
+uint16_t BerInteger(const BerTlv& tlv);
+bool BerBoolean(const BerTlv& tlv);
+
+// Defined inline, the decoder sits on the path of every touch frame.
+
+#define BER_ALWAYS_INLINE inline __attribute__((always_inline))
+
+BER_ALWAYS_INLINE BerReader::BerReader(const uint8_t* data, uint8_t length) :
+  cursor(data), end(data + length), malformed(false)
+{
+}
+
+BER_ALWAYS_INLINE BerReader::BerReader(const BerTlv& constructed) :
+  cursor(constructed.value), end(constructed.value + constructed.length), malformed(false)
+{
+}
+
+/*
+ * Reads the next element. Returns false at the end of the buffer or if the
+ * element does not fit, in which case IsMalformed() is set and the reader
+ * stays on the offending element.
+ */
+BER_ALWAYS_INLINE bool BerReader::Next(BerTlv& tlv)
+{
+  const uint8_t* p = cursor;
+  if (end - p < 2)
+  {
+    malformed = p != end;
+    return false;
+  }
+
+  uint8_t valueLength = p[1];
+  p += 2;
+
+  if (valueLength & 0x80) // Long form, zForce frames never need more than one length byte.
+  {
+    if (valueLength != 0x81 || p == end)
+    {
+      malformed = true;
+      return false;
+    }
+    valueLength = *p++;
+  }
+
+  if (valueLength > end - p)
+  {
+    malformed = true;
+    return false;
+  }
+
+  tlv.tag = cursor[0];
+  tlv.length = valueLength;
+  tlv.value = p;
+  cursor = p + valueLength;
+
+  return true;
+}
+
+/*
+ * Decodes a non-negative INTEGER, saturating values that do not fit 16 bits.
+ */
+inline uint16_t BerInteger(const BerTlv& tlv)
+{
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < tlv.length; i++)
+  {
+    value = (value << 8) | tlv.value[i];
+    if (value > 0xFFFF)
+    {
+      return 0xFFFF;
+    }
+  }
+
+  return (uint16_t)value;
+}
+
+inline bool BerBoolean(const BerTlv& tlv)
+{
+  return tlv.length > 0 && tlv.value[0] != 0x00;
+}
@@ -0,0 +1,294 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include <string.h>
+
+/*
+ * Compile time encoder for zForce request frames.
+ *
+ * A request is described by nesting field descriptors, for example
+ *
+ *   ZforceRequest<BerSequence<0x73, BerSequence<0xA2, BerUint16<0x80>, BerUint16<0x81> > > >
+ *
+ * All tags and lengths are worked out by the compiler and the frame is stored
+ * as one constant byte array. Fields without a runtime value (BerNull,
+ * BerConstant) make the whole frame constant so it can be written as is; for
+ * the others Encode() copies the frame and patches the values in place at
+ * offsets that are also known at compile time.
+ */
+
+template <uint8_t... Bytes>
+struct BerBytes
+{
+	static const uint8_t size = sizeof...(Bytes);
+	static const uint8_t data[sizeof...(Bytes) > 0 ? sizeof...(Bytes) : 1];
+};
+
+template <uint8_t... Bytes>
+const uint8_t BerBytes<Bytes...>::data[sizeof...(Bytes) > 0 ? sizeof...(Bytes) : 1] = {Bytes...};
+
+template <typename... Parts>
+struct BerConcat;
+
+template <>
+struct BerConcat<>
+{
+	typedef BerBytes<> type;
+};
+
+template <uint8_t... A>
+struct BerConcat<BerBytes<A...> >
+{
+	typedef BerBytes<A...> type;
+};
+
+template <uint8_t... A, uint8_t... B, typename... Rest>
+struct BerConcat<BerBytes<A...>, BerBytes<B...>, Rest...>
+{
+	typedef typename BerConcat<BerBytes<A..., B...>, Rest...>::type type;
+};
+
+// Number of runtime values taken by a list of fields.
+template <typename... Fields>
+struct BerFieldCount;
+
+template <>
+struct BerFieldCount<>
+{
+	static const uint8_t value = 0;
+};
+
+template <typename Field, typename... Rest>
+struct BerFieldCount<Field, Rest...>
+{
+	static const uint8_t value = Field::fields + BerFieldCount<Rest...>::value;
+};
+
+// Patches the values of a list of fields that starts at Offset in the frame.
+template <uint8_t Offset, typename... Fields>
+struct BerPatch;
+
+template <uint8_t Offset>
+struct BerPatch<Offset>
+{
+	static void Apply(uint8_t* frame, const uint16_t* values) {}
+};
+
+template <uint8_t Offset, typename Field, typename... Rest>
+struct BerPatch<Offset, Field, Rest...>
+{
+	static void Apply(uint8_t* frame, const uint16_t* values)
+	{
+		Field::template Patch<Offset>(frame, values);
+		BerPatch<Offset + Field::bytes::size, Rest...>::Apply(frame, values + Field::fields);
+	}
+};
+
+// Primitive with a fixed value, e.g. BerConstant<0x86, 0xFF>.
+template <uint8_t Tag, uint8_t... Value>
+struct BerConstant
+{
+	typedef BerBytes<Tag, sizeof...(Value), Value...> bytes;
+	static const uint8_t fields = 0;
+	template <uint8_t Offset>
+	static void Patch(uint8_t* frame, const uint16_t* values) {}
+};
+
+// Primitive without contents, e.g. the enable/disable choice.
+template <uint8_t Tag>
+struct BerNull : BerConstant<Tag>
+{
+};
+
+// Boolean taken from the next runtime value, encoded as 0xFF or 0x00.
+template <uint8_t Tag>
+struct BerBool
+{
+	typedef BerBytes<Tag, 0x01, 0x00> bytes;
+	static const uint8_t fields = 1;
+	template <uint8_t Offset>
+	static void Patch(uint8_t* frame, const uint16_t* values)
+	{
+		frame[Offset + 2] = values[0] ? 0xFF : 0x00;
+	}
+};
+
+// One byte integer taken from the next runtime value.
+template <uint8_t Tag>
+struct BerUint8
+{
+	typedef BerBytes<Tag, 0x01, 0x00> bytes;
+	static const uint8_t fields = 1;
+	template <uint8_t Offset>
+	static void Patch(uint8_t* frame, const uint16_t* values)
+	{
+		frame[Offset + 2] = (uint8_t)values[0];
+	}
+};
+
+// Two byte big endian integer taken from the next runtime value.
+template <uint8_t Tag>
+struct BerUint16
+{
+	typedef BerBytes<Tag, 0x02, 0x00, 0x00> bytes;
+	static const uint8_t fields = 1;
+	template <uint8_t Offset>
+	static void Patch(uint8_t* frame, const uint16_t* values)
+	{
+		frame[Offset + 2] = (uint8_t)(values[0] >> 8);
+		frame[Offset + 3] = (uint8_t)(values[0] & 0xFF);
+	}
+};
+
+// Constructed element holding the given fields.
+template <uint8_t Tag, typename... Fields>
+struct BerSequence
+{
+	typedef typename BerConcat<typename Fields::bytes...>::type content;
+	static_assert(content::size < 0x80, "BER long form lengths are not supported");
+	typedef typename BerConcat<BerBytes<Tag, content::size>, content>::type bytes;
+	static const uint8_t fields = BerFieldCount<Fields...>::value;
+	template <uint8_t Offset>
+	static void Patch(uint8_t* frame, const uint16_t* values)
+	{
+		BerPatch<Offset + 2, Fields...>::Apply(frame, values);
+	}
+};
+
+/*
+ * A complete request: the I2C header (0xEE and the length of what follows)
+ * and the BER request holding the device address and the given content.
+ */
+template <typename Content>
+struct ZforceRequest
+{
+	typedef BerSequence<0xEE, BerConstant<0x40, 0x02, 0x00>, Content> request;
+	typedef typename BerConcat<BerBytes<0xEE, request::bytes::size>, typename request::bytes>::type bytes;
+	static const uint8_t size = bytes::size;
+	static const uint8_t fields = request::fields;
+
+	// The frame with all runtime values set to zero.
+	static const uint8_t* Frame() { return bytes::data; }
+
+	// Builds the frame into the size bytes at frame, taking one value per field in declaration order.
+	static void Encode(uint8_t* frame, const uint16_t* values)
+	{
+		memcpy(frame, bytes::data, size);
+		request::template Patch<2>(frame, values);
+	}
+};
+
+/*
+ * Runtime counterpart of the encoder above for requests whose fields are only
+ * known at runtime, e.g. a device configuration holding any subset of the
+ * settings. Constructed elements are opened with Begin() and closed with
+ * End(), which fills in the length. Lengths must stay in short form; a writer
+ * that ran out of room or nesting levels reports it through IsOverflowed().
+ */
+#define BER_WRITER_MAX_DEPTH 4
+
+class BerWriter
+{
+	public:
+		BerWriter(uint8_t* buffer, uint8_t size) : buffer(buffer), size(size), length(0), depth(0), overflowed(false) {}
+
+		void Begin(uint8_t tag)
+		{
+			if (depth == BER_WRITER_MAX_DEPTH)
+			{
+				overflowed = true;
+				return;
+			}
+			Put(tag);
+			open[depth++] = length;
+			Put(0x00);
+		}
+
+		void End()
+		{
+			if (depth == 0 || overflowed)
+			{
+				overflowed = true;
+				return;
+			}
+			uint8_t start = open[--depth];
+			uint8_t contentLength = length - start - 1;
+			if (contentLength >= 0x80)
+			{
+				overflowed = true;
+				return;
+			}
+			buffer[start] = contentLength;
+		}
+
+		void Bytes(const uint8_t* data, uint8_t count)
+		{
+			for (uint8_t i = 0; i < count; i++)
+			{
+				Put(data[i]);
+			}
+		}
+
+		void Boolean(uint8_t tag, bool value)
+		{
+			Put(tag);
+			Put(0x01);
+			Put(value ? 0xFF : 0x00);
+		}
+
+		void Uint8(uint8_t tag, uint8_t value)
+		{
+			Put(tag);
+			Put(0x01);
+			Put(value);
+		}
+
+		void Uint16(uint8_t tag, uint16_t value)
+		{
+			Put(tag);
+			Put(0x02);
+			Put((uint8_t)(value >> 8));
+			Put((uint8_t)(value & 0xFF));
+		}
+
+		uint8_t Length() const { return length; }
+		bool IsOverflowed() const { return overflowed || depth != 0; }
+
+	private:
+		void Put(uint8_t value)
+		{
+			if (length < size)
+			{
+				buffer[length++] = value;
+			}
+			else
+			{
+				overflowed = true;
+			}
+		}
+
+		uint8_t* buffer;
+		uint8_t size;
+		uint8_t length;
+		uint8_t depth;
+		uint8_t open[BER_WRITER_MAX_DEPTH];
+		bool overflowed;
+};
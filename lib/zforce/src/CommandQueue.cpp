@@ -0,0 +1,426 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include <inttypes.h>
+#if(ARDUINO >= 100)
+  #include <Arduino.h>
+#else
+  #include <WProgram.h>
+#endif
+#include "CommandQueue.h"
+
+// The DeviceConfiguration flag of a single setting message type, 0 for any other type.
+static uint8_t ConfigurationField(MessageType type)
+{
+  switch (type)
+  {
+    case MessageType::TOUCHACTIVEAREATYPE:
+      return CONFIG_TOUCH_ACTIVE_AREA;
+    case MessageType::REVERSEXTYPE:
+      return CONFIG_REVERSE_X;
+    case MessageType::REVERSEYTYPE:
+      return CONFIG_REVERSE_Y;
+    case MessageType::FLIPXYTYPE:
+      return CONFIG_FLIP_XY;
+    case MessageType::REPORTEDTOUCHESTYPE:
+      return CONFIG_REPORTED_TOUCHES;
+    default:
+      return 0;
+  }
+}
+
+/*
+ * Responses are identified by their content. A combined configuration that only
+ * holds one setting is answered with the message type of that setting, and a
+ * single setting may be answered with a device configuration that holds it
+ * among others.
+ */
+static bool Answers(MessageType request, const MessageVariant& response)
+{
+  if (request == response.type)
+  {
+    return true;
+  }
+
+  if (request == MessageType::DEVICECONFIGURATIONTYPE)
+  {
+    return ConfigurationField(response.type) != 0;
+  }
+
+  return response.type == MessageType::DEVICECONFIGURATIONTYPE &&
+         (response.configuration.fields & ConfigurationField(request)) != 0;
+}
+
+/*
+ * Turns a device configuration response into the message of the one setting
+ * that was requested, so callbacks always get the type they asked for.
+ */
+static void SelectSetting(MessageVariant& msg, MessageType type)
+{
+  DeviceConfiguration config = msg.configuration;
+
+  msg.type = type;
+  switch (type)
+  {
+    case MessageType::TOUCHACTIVEAREATYPE:
+      msg.touchActiveArea = config.touchActiveArea;
+    break;
+    case MessageType::REVERSEXTYPE:
+      msg.reversed = config.reverseX;
+    break;
+    case MessageType::REVERSEYTYPE:
+      msg.reversed = config.reverseY;
+    break;
+    case MessageType::FLIPXYTYPE:
+      msg.flipXY = config.flipXY;
+    break;
+    case MessageType::REPORTEDTOUCHESTYPE:
+      msg.reportedTouches = config.reportedTouches;
+    break;
+    default:
+    break;
+  }
+}
+
+/*
+ * Adds the settings in a configuration response, of any of the types Answers()
+ * accepts for a DEVICECONFIGURATIONTYPE request, to config.
+ */
+static void MergeConfiguration(DeviceConfiguration& config, const MessageVariant& response)
+{
+  const DeviceConfiguration& reported = response.configuration;
+
+  switch (response.type)
+  {
+    case MessageType::TOUCHACTIVEAREATYPE:
+      config.touchActiveArea = response.touchActiveArea;
+      config.fields |= CONFIG_TOUCH_ACTIVE_AREA;
+    break;
+    case MessageType::REVERSEXTYPE:
+      config.reverseX = response.reversed;
+      config.fields |= CONFIG_REVERSE_X;
+    break;
+    case MessageType::REVERSEYTYPE:
+      config.reverseY = response.reversed;
+      config.fields |= CONFIG_REVERSE_Y;
+    break;
+    case MessageType::FLIPXYTYPE:
+      config.flipXY = response.flipXY;
+      config.fields |= CONFIG_FLIP_XY;
+    break;
+    case MessageType::REPORTEDTOUCHESTYPE:
+      config.reportedTouches = response.reportedTouches;
+      config.fields |= CONFIG_REPORTED_TOUCHES;
+    break;
+    case MessageType::DEVICECONFIGURATIONTYPE:
+      if (reported.fields & CONFIG_TOUCH_ACTIVE_AREA)
+      {
+        config.touchActiveArea = reported.touchActiveArea;
+      }
+      if (reported.fields & CONFIG_REVERSE_X)
+      {
+        config.reverseX = reported.reverseX;
+      }
+      if (reported.fields & CONFIG_REVERSE_Y)
+      {
+        config.reverseY = reported.reverseY;
+      }
+      if (reported.fields & CONFIG_FLIP_XY)
+      {
+        config.flipXY = reported.flipXY;
+      }
+      if (reported.fields & CONFIG_REPORTED_TOUCHES)
+      {
+        config.reportedTouches = reported.reportedTouches;
+      }
+      config.fields |= reported.fields & CONFIG_ALL;
+    break;
+    default:
+    break;
+  }
+}
+
+CommandQueue::CommandQueue() : sensor(nullptr), head(0), count(0), nextHandle(1), rejected(0), stray(0)
+{
+  memset(commands, 0, sizeof(commands));
+  memset(stats, 0, sizeof(stats));
+  memset(&answered, 0, sizeof(answered));
+}
+
+CommandQueue::CommandQueue(ZforceBase& sensor) : CommandQueue()
+{
+  this->sensor = &sensor;
+}
+
+/*
+ * Binds a queue made without a sensor, e.g. one of an array. Commands already
+ * queued go to the new sensor.
+ */
+void CommandQueue::Attach(ZforceBase& sensor)
+{
+  this->sensor = &sensor;
+}
+
+/*
+ * Queues a command. The timeout in ms runs from the moment the command is next
+ * in line, so it also covers the wait for data ready to go low before it can be
+ * written. Returns COMMAND_INVALID_HANDLE if the queue is full.
+ */
+uint16_t CommandQueue::Submit(const CommandRequest& request, CommandCallback callback, void* context, unsigned long timeout)
+{
+  if (count == COMMAND_QUEUE_SIZE)
+  {
+    rejected++;
+    return COMMAND_INVALID_HANDLE;
+  }
+
+  Command& command = commands[(head + count) % COMMAND_QUEUE_SIZE];
+  command.request = request;
+  command.callback = callback;
+  command.context = context;
+  command.timeout = timeout;
+  command.status = CommandStatus::QUEUED;
+  command.pendingFields = request.type == MessageType::DEVICECONFIGURATIONTYPE ? request.configuration.fields & CONFIG_ALL : 0;
+  command.sentFields = 0;
+  command.startedAt = micros();
+  command.handle = nextHandle++;
+  if (nextHandle == COMMAND_INVALID_HANDLE)
+  {
+    nextHandle++;
+  }
+  count++;
+
+  return command.handle;
+}
+
+/*
+ * A completed command keeps its status until its slot is reused, which is at
+ * the earliest COMMAND_QUEUE_SIZE submissions later.
+ */
+CommandStatus CommandQueue::Status(uint16_t handle) const
+{
+  for (uint8_t i = 0; i < COMMAND_QUEUE_SIZE; i++)
+  {
+    if (handle != COMMAND_INVALID_HANDLE && commands[i].handle == handle)
+    {
+      return commands[i].status;
+    }
+  }
+
+  return CommandStatus::UNKNOWN;
+}
+
+/*
+ * Reads at most one message and moves the outstanding command along. Returns
+ * true if msg holds a notification for the caller; responses are consumed and
+ * delivered to the command callbacks.
+ */
+bool CommandQueue::Poll(MessageVariant& msg)
+{
+  bool notification = false;
+
+  if (sensor == nullptr)
+  {
+    return false;
+  }
+
+  if (sensor->GetMessage(msg))
+  {
+    if (msg.type == MessageType::TOUCHTYPE || msg.type == MessageType::BOOTCOMPLETETYPE)
+    {
+      notification = true;
+    }
+    else if (count > 0 && commands[head].status == CommandStatus::SENT && Answers(commands[head].request.type, msg))
+    {
+      Command& command = commands[head];
+      if (command.request.type == MessageType::DEVICECONFIGURATIONTYPE)
+      {
+        MergeConfiguration(answered, msg);
+      }
+      else if (msg.type == MessageType::DEVICECONFIGURATIONTYPE)
+      {
+        SelectSetting(msg, command.request.type);
+      }
+      if (command.pendingFields != 0)
+      {
+        command.status = CommandStatus::QUEUED; // The rest goes out below once data ready is low.
+      }
+      else
+      {
+        if (command.request.type == MessageType::DEVICECONFIGURATIONTYPE &&
+            command.sentFields != (command.request.configuration.fields & CONFIG_ALL))
+        {
+          // Split: the caller gets what all requests reported, in place of the last response.
+          msg.type = MessageType::DEVICECONFIGURATIONTYPE;
+          msg.configuration = answered;
+        }
+        Complete(command, CommandStatus::DONE, &msg);
+      }
+    }
+    else
+    {
+      stray++; // A response nobody waits for anymore, e.g. after a timeout.
+    }
+  }
+
+  if (count > 0 && micros() - commands[head].startedAt >= commands[head].timeout * 1000UL)
+  {
+    Complete(commands[head], CommandStatus::TIMEDOUT, nullptr);
+  }
+
+  // The sensor must not have anything pending for us when a request is written.
+  while (count > 0 && commands[head].status == CommandStatus::QUEUED && sensor->GetDataReady() == LOW)
+  {
+    if (Send(commands[head]))
+    {
+      break;
+    }
+  }
+
+  return notification;
+}
+
+const CommandStats& CommandQueue::Stats(MessageType type) const
+{
+  uint8_t index = (uint8_t)type < COMMAND_TYPES ? (uint8_t)type : 0;
+  return stats[index];
+}
+
+bool CommandQueue::Send(Command& command)
+{
+  bool written = false;
+  bool first = command.sentFields == 0; // A split configuration comes back here for its next request.
+  const CommandRequest& request = command.request;
+
+  switch (request.type)
+  {
+    case MessageType::ENABLETYPE:
+      written = sensor->Enable(request.enabled);
+    break;
+    case MessageType::TOUCHACTIVEAREATYPE:
+      written = sensor->TouchActiveArea(request.touchActiveArea.minX, request.touchActiveArea.minY,
+                                       request.touchActiveArea.maxX, request.touchActiveArea.maxY);
+    break;
+    case MessageType::REVERSEXTYPE:
+      written = sensor->ReverseX(request.reversed);
+    break;
+    case MessageType::REVERSEYTYPE:
+      written = sensor->ReverseY(request.reversed);
+    break;
+    case MessageType::FLIPXYTYPE:
+      written = sensor->FlipXY(request.flipXY);
+    break;
+    case MessageType::REPORTEDTOUCHESTYPE:
+      written = sensor->ReportedTouches(request.reportedTouches);
+    break;
+    case MessageType::DEVICECONFIGURATIONTYPE:
+      written = SendConfiguration(command);
+    break;
+    default:
+    break;
+  }
+
+  if (written)
+  {
+    if (first)
+    {
+      command.sentAt = micros();
+    }
+    command.status = CommandStatus::SENT;
+  }
+  else
+  {
+    Complete(command, CommandStatus::FAILED, nullptr);
+  }
+
+  return written;
+}
+
+/*
+ * Writes as many of the pending settings as the transport takes in one request,
+ * in the order of their flags. Fails if not even one setting fits.
+ */
+bool CommandQueue::SendConfiguration(Command& command)
+{
+  DeviceConfiguration part = command.request.configuration;
+  part.fields = 0;
+
+  for (uint8_t field = CONFIG_TOUCH_ACTIVE_AREA; field & CONFIG_ALL; field <<= 1)
+  {
+    if ((command.pendingFields & field) && ZforceBase::ConfigurationLength(part.fields | field) <= sensor->MaxWrite())
+    {
+      part.fields |= field;
+    }
+  }
+
+  if (part.fields == 0 || !sensor->Configure(part))
+  {
+    return false;
+  }
+
+  if (command.sentFields == 0)
+  {
+    memset(&answered, 0, sizeof(answered));
+  }
+  command.pendingFields &= ~part.fields;
+  command.sentFields = part.fields;
+  return true;
+}
+
+/*
+ * Frees the slot before the callback runs, so the callback may submit again.
+ */
+void CommandQueue::Complete(Command& command, CommandStatus status, const MessageVariant* response)
+{
+  CommandStats& commandStats = stats[(uint8_t)command.request.type < COMMAND_TYPES ? (uint8_t)command.request.type : 0];
+
+  if (status == CommandStatus::DONE)
+  {
+    unsigned long latency = micros() - command.sentAt;
+    commandStats.completed++;
+    commandStats.lastLatency = latency;
+    commandStats.totalLatency += latency;
+    if (latency > commandStats.maxLatency)
+    {
+      commandStats.maxLatency = latency;
+    }
+  }
+  else if (status == CommandStatus::TIMEDOUT)
+  {
+    commandStats.timeouts++;
+  }
+  else
+  {
+    commandStats.failed++;
+  }
+
+  command.status = status;
+  head = (head + 1) % COMMAND_QUEUE_SIZE;
+  count--;
+  if (count > 0)
+  {
+    commands[head].startedAt = micros();
+  }
+
+  if (command.callback != nullptr)
+  {
+    command.callback(command.handle, status, response, command.context);
+  }
+}
@@ -0,0 +1,123 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "Zforce.h"
+
+#define COMMAND_QUEUE_SIZE 4
+#define COMMAND_DEFAULT_TIMEOUT 100 // ms
+#define COMMAND_INVALID_HANDLE 0
+#define COMMAND_TYPES 10 // MessageType values, for the per command statistics
+
+enum class CommandStatus
+{
+	UNKNOWN = 0, // Not a handle, or completed so long ago that its slot was reused.
+	QUEUED = 1,
+	SENT = 2,
+	DONE = 3,
+	FAILED = 4,  // The request could not be written.
+	TIMEDOUT = 5
+};
+
+/*
+ * A request for the sensor. Only the member matching type is used, with the
+ * same meaning as in MessageVariant.
+ */
+typedef struct CommandRequest
+{
+	MessageType type;
+	union
+	{
+		bool enabled;
+		TouchActiveAreaData touchActiveArea;
+		bool flipXY;
+		bool reversed;
+		uint8_t reportedTouches;
+		DeviceConfiguration configuration;
+	};
+} CommandRequest;
+
+// Called once per command; response is nullptr unless status is DONE.
+typedef void (*CommandCallback)(uint16_t handle, CommandStatus status, const MessageVariant* response, void* context);
+
+typedef struct CommandStats
+{
+	unsigned long completed;
+	unsigned long failed;
+	unsigned long timeouts;
+	unsigned long lastLatency;  // us from the write to the response being read
+	unsigned long maxLatency;
+	unsigned long totalLatency; // over all completed commands, for the average
+} CommandStats;
+
+/*
+ * Non-blocking command engine. Commands are queued with Submit() and sent one
+ * at a time, as the sensor only has one request outstanding. Poll() is called
+ * from the normal loop instead of GetMessage(): it reads whatever the sensor
+ * has, completes the outstanding command on its response or its timeout,
+ * sends the next one once data ready is low and hands every notification
+ * back to the caller. Nothing in here waits for the sensor.
+ *
+ * A device configuration longer than the transport can write at once is sent
+ * as several requests, one after the other, and completes with a single
+ * DEVICECONFIGURATIONTYPE response that merges what the sensor reported back.
+ */
+class CommandQueue
+{
+	public:
+		CommandQueue();
+		CommandQueue(ZforceBase& sensor);
+		void Attach(ZforceBase& sensor);
+		uint16_t Submit(const CommandRequest& request, CommandCallback callback = nullptr, void* context = nullptr,
+		                unsigned long timeout = COMMAND_DEFAULT_TIMEOUT);
+		CommandStatus Status(uint16_t handle) const;
+		bool Poll(MessageVariant& msg);
+		bool IsIdle() const { return count == 0; }
+		const CommandStats& Stats(MessageType type) const;
+		unsigned long Rejected() const { return rejected; }
+		unsigned long Stray() const { return stray; }
+	private:
+		typedef struct Command
+		{
+			CommandRequest request;
+			CommandCallback callback;
+			void* context;
+			unsigned long timeout;
+			unsigned long startedAt; // when it became the head of the queue
+			unsigned long sentAt;
+			uint16_t handle;
+			CommandStatus status;
+			uint8_t pendingFields; // configuration settings not written yet
+			uint8_t sentFields;    // settings of the last configuration request written
+		} Command;
+
+		bool Send(Command& command);
+		bool SendConfiguration(Command& command);
+		void Complete(Command& command, CommandStatus status, const MessageVariant* response);
+		ZforceBase* sensor;
+		Command commands[COMMAND_QUEUE_SIZE];
+		uint8_t head;
+		uint8_t count;
+		uint16_t nextHandle;
+		unsigned long rejected;
+		unsigned long stray;
+		CommandStats stats[COMMAND_TYPES];
+		DeviceConfiguration answered; // what the sensor reported for the head command so far
+};
@@ -71,6 +71,24 @@ uint8_t I2C::bytesAvailable = 0;
 uint8_t I2C::bufferIndex = 0;
 uint8_t I2C::totalBytes = 0;
 uint16_t I2C::timeOutDelay = 0;
+#if I2C_ASYNC
+volatile uint8_t I2C::asyncState = 0;
+volatile uint8_t I2C::asyncStatus = 0;
+volatile unsigned long I2C::asyncStepTime = 0;
+uint8_t I2C::asyncAddress = 0;
+uint8_t *I2C::asyncBuffer = NULL;
+uint8_t I2C::asyncSize = 0;
+volatile uint16_t I2C::asyncTotal = 0;
+volatile uint16_t I2C::asyncCount = 0;
+void (*I2C::asyncCallback)(uint8_t) = NULL;
+
+#define ASYNC_IDLE    0
+#define ASYNC_START   1
+#define ASYNC_ADDRESS 2
+#define ASYNC_DATA    3
+// asyncTotal until the length byte of a frame has been received
+#define ASYNC_FRAME   0xFFFF
+#endif
 
 I2C::I2C()
 {
@@ -165,13 +183,7 @@ void I2C::scan()
   Serial.println();
   for(uint8_t s = 0; s <= 0x7F; s++)
   {
-    returnStatus = 0;
-    returnStatus = start();
-    if(!returnStatus)
-    { 
-      returnStatus = sendAddress(SLA_W(s));
-    }
-    if(returnStatus)
+    if(probe(s))
     {
       if(returnStatus == 1)
       {
@@ -187,12 +199,31 @@ void I2C::scan()
       Serial.println(s,HEX);
       totalDevicesFound++;
     }
-    stop();
   }
   if(!totalDevicesFound){Serial.println("No devices found");}
   timeOutDelay = tempTime;
 }
 
+/*
+ * Addresses one device the way scan() does. Returns 0 if it acknowledged,
+ * 1 if the bus timed out, otherwise the status of the address NACK.
+ */
+uint8_t I2C::probe(uint8_t address)
+{
+  returnStatus = 0;
+  returnStatus = start();
+  if(!returnStatus)
+  {
+    returnStatus = sendAddress(SLA_W(address));
+  }
+  if(returnStatus == 1)
+  {
+    return(returnStatus);
+  }
+  stop();
+  return(returnStatus);
+}
+
 
 uint8_t I2C::available()
 {
@@ -560,6 +591,119 @@ uint8_t I2C::read(uint8_t address, uint8_t registerAddress, uint8_t numberBytes,
   return(returnStatus);
 }
 
+#if I2C_ASYNC
+/*
+ * The asynchronous reads only start the transfer; every following bus event
+ * is handled from the TWI interrupt, so the CPU is free while the bytes are
+ * clocked in. Poll pending() until it returns 0, or pass a callback which is
+ * called from the interrupt with the same status codes as read(). A new
+ * transfer can not be started while one is pending (returns I2C_BUSY).
+ */
+uint8_t I2C::readAsync(uint8_t address, uint8_t numberBytes, uint8_t *dataBuffer, void (*callback)(uint8_t))
+{
+  if(numberBytes == 0){numberBytes++;}
+  return(beginAsync(address, dataBuffer, numberBytes, numberBytes, callback));
+}
+
+// Reads a length prefixed frame as sent by the zForce sensor: the second byte
+// holds the number of bytes that follow. Bytes that do not fit in size are
+// read from the bus but dropped; result() is 0 and the frame is cut short.
+uint8_t I2C::readFrameAsync(uint8_t address, uint8_t *dataBuffer, uint8_t size, void (*callback)(uint8_t))
+{
+  return(beginAsync(address, dataBuffer, size, ASYNC_FRAME, callback));
+}
+
+// Returns non zero while a transfer is running. Also enforces timeOut(): a
+// transfer that got stuck is aborted with the same codes as read(), 1 while
+// sending the start condition, 5 for the address and 6 for the data.
+uint8_t I2C::pending()
+{
+  noInterrupts();
+  uint8_t state = asyncState;
+  unsigned long stepTime = asyncStepTime;
+  interrupts();
+  if(state == ASYNC_IDLE){return(0);}
+  if(timeOutDelay && (millis() - stepTime) >= timeOutDelay)
+  {
+    noInterrupts();
+    if(asyncState == state)
+    {
+      lockUp();
+      finishAsync(state == ASYNC_START ? 1 : (state == ASYNC_ADDRESS ? 5 : 6));
+    }
+    interrupts();
+    return(asyncState != ASYNC_IDLE);
+  }
+  return(1);
+}
+
+// Status of the last asynchronous transfer, valid once pending() is 0.
+uint8_t I2C::result()
+{
+  return(asyncStatus);
+}
+
+void I2C::handleInterrupt()
+{
+  uint8_t status = TWI_STATUS;
+  asyncStepTime = millis();
+  switch(asyncState)
+  {
+    case ASYNC_START:
+      if((status == START) || (status == REPEATED_START))
+      {
+        asyncState = ASYNC_ADDRESS;
+        TWDR = SLA_R(asyncAddress);
+        TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+        return;
+      }
+      break;
+    case ASYNC_ADDRESS:
+      if(status == MR_SLA_ACK)
+      {
+        asyncState = ASYNC_DATA;
+        receiveAsync();
+        return;
+      }
+      if(status == MR_SLA_NACK)
+      {
+        TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+        finishAsync(status);
+        return;
+      }
+      break;
+    case ASYNC_DATA:
+      if((status == MR_DATA_ACK) || (status == MR_DATA_NACK))
+      {
+        uint8_t received = TWDR;
+        if(asyncCount < asyncSize){asyncBuffer[asyncCount] = received;}
+        asyncCount++;
+        if((asyncCount == 2) && (asyncTotal == ASYNC_FRAME))
+        {
+          asyncTotal = (uint16_t)received + 2;
+        }
+        if(status == MR_DATA_NACK)
+        {
+          TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+          bytesAvailable = asyncCount < asyncSize ? asyncCount : asyncSize;
+          totalBytes = bytesAvailable;
+          finishAsync(0);
+          return;
+        }
+        receiveAsync();
+        return;
+      }
+      break;
+    default:
+      // Not ours, e.g. a late interrupt after a timeout
+      TWCR = (1<<TWEN) | (1<<TWEA);
+      return;
+  }
+  lockUp();
+  finishAsync(status);
+}
+#endif
+
 
 /////////////// Private Methods ////////////////////////////////////////
 
@@ -708,6 +852,66 @@ void I2C::lockUp()
   TWCR = _BV(TWEN) | _BV(TWEA); //reinitialize TWI
 }
 
+#if I2C_ASYNC
+uint8_t I2C::beginAsync(uint8_t address, uint8_t *dataBuffer, uint8_t size, uint16_t total, void (*callback)(uint8_t))
+{
+  if(asyncState != ASYNC_IDLE){return(I2C_BUSY);}
+  // the stop condition of the previous transfer may still be on the bus
+  unsigned long startingTime = millis();
+  while ((TWCR & (1<<TWSTO)))
+  {
+    if(!timeOutDelay){continue;}
+    if((millis() - startingTime) >= timeOutDelay)
+    {
+      lockUp();
+      return(7);
+    }
+  }
+  bytesAvailable = 0;
+  bufferIndex = 0;
+  asyncAddress = address;
+  asyncBuffer = dataBuffer;
+  asyncSize = size;
+  asyncTotal = total;
+  asyncCount = 0;
+  asyncCallback = callback;
+  asyncStatus = 0;
+  asyncStepTime = millis();
+  asyncState = ASYNC_START;
+  TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+  return(0);
+}
+
+// Acknowledges every byte except the last one of the transfer. The frame
+// length is not known before the second byte, so those two are always acked;
+// a frame without a body is closed with one extra, unacknowledged byte.
+void I2C::receiveAsync()
+{
+  if((asyncTotal == ASYNC_FRAME) || (asyncCount + 1 < asyncTotal))
+  {
+    TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWEA) | (1<<TWIE);
+  }
+  else
+  {
+    TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+  }
+}
+
+void I2C::finishAsync(uint8_t status)
+{
+  asyncStatus = status;
+  asyncState = ASYNC_IDLE;
+  if(asyncCallback){asyncCallback(status);}
+}
+#endif
+
 I2C I2c = I2C();
 
+#if I2C_ASYNC
+ISR(TWI_vect)
+{
+  I2c.handleInterrupt();
+}
+#endif
+
 #endif // endif USE_I2C_LIB
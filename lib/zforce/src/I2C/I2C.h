@@ -93,6 +93,14 @@
 
 #define MAX_BUFFER_SIZE 32
 
+// readAsync() and readFrameAsync() run the transfer from the TWI interrupt.
+// Define I2C_ASYNC as 0 when the Wire library is linked too, as it installs
+// its own TWI interrupt handler.
+#ifndef I2C_ASYNC
+#define I2C_ASYNC 1
+#endif
+#define I2C_BUSY 0xFF
+
 
 
 
@@ -106,6 +114,7 @@ class I2C
     void setSpeed(uint8_t); 
     void pullup(uint8_t);
     void scan();
+    uint8_t probe(uint8_t);
     uint8_t available();
     uint8_t receive();
     uint8_t write(uint8_t, uint8_t);
@@ -120,6 +129,13 @@ class I2C
     uint8_t read(int, int, int);
     uint8_t read(uint8_t, uint8_t, uint8_t*);
     uint8_t read(uint8_t, uint8_t, uint8_t, uint8_t*);
+#if I2C_ASYNC
+    uint8_t readAsync(uint8_t, uint8_t, uint8_t*, void (*)(uint8_t) = NULL);
+    uint8_t readFrameAsync(uint8_t, uint8_t*, uint8_t, void (*)(uint8_t) = NULL);
+    uint8_t pending();
+    uint8_t result();
+    void handleInterrupt();
+#endif
 
 
   private:
@@ -129,6 +145,11 @@ class I2C
     uint8_t receiveByte(uint8_t);
     uint8_t stop();
     void lockUp();
+#if I2C_ASYNC
+    uint8_t beginAsync(uint8_t, uint8_t*, uint8_t, uint16_t, void (*)(uint8_t));
+    void receiveAsync();
+    void finishAsync(uint8_t);
+#endif
     uint8_t returnStatus;
     uint8_t nack;
     uint8_t data[MAX_BUFFER_SIZE];
@@ -136,6 +157,17 @@ class I2C
     static uint8_t bufferIndex;
     static uint8_t totalBytes;
     static uint16_t timeOutDelay;
+#if I2C_ASYNC
+    static volatile uint8_t asyncState;
+    static volatile uint8_t asyncStatus;
+    static volatile unsigned long asyncStepTime;
+    static uint8_t asyncAddress;
+    static uint8_t *asyncBuffer;
+    static uint8_t asyncSize;
+    static volatile uint16_t asyncTotal;
+    static volatile uint16_t asyncCount;
+    static void (*asyncCallback)(uint8_t);
+#endif
 
 };
 
@@ -0,0 +1,105 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "../Zforce.h"
+#include "I2C.h"
+
+#if USE_I2C_LIB
+
+/*
+ * Sensor on the AVR TWI through the I2C library, which reads straight into
+ * the caller's buffer. With I2C_ASYNC frames are read from the TWI interrupt
+ * by BeginRead(); otherwise BeginRead() reads the whole frame.
+ */
+class I2cTransport
+{
+	public:
+		static const bool readsFrames = I2C_ASYNC;
+		static const bool armsOnDataReady = false;
+		static const uint8_t maxWrite = MAX_PAYLOAD;
+
+		I2cTransport(uint8_t address = ZFORCE_I2C_ADDRESS) : address(address), buffer(nullptr), size(0) {}
+
+		void Begin(int dataReady, uint8_t* buffer, uint8_t size)
+		{
+			this->buffer = buffer;
+			this->size = size;
+			I2c.setSpeed(1);
+			I2c.begin();
+		}
+
+		int Read(uint8_t* data, uint8_t count, ReadStats& stats)
+		{
+			stats.transactions++;
+			stats.bytes += count;
+			return I2c.read(address, count, data);
+		}
+
+		int Write(const uint8_t* data, uint8_t length)
+		{
+			return I2c.write(address, data[0], (uint8_t*)&data[1], length - 1); // 0 if success, otherwise error code according to Atmel Data Sheet
+		}
+
+		bool Probe()
+		{
+			return I2c.probe(address) == 0;
+		}
+
+#if I2C_ASYNC
+		int BeginFrame()
+		{
+			return I2c.readFrameAsync(address, buffer, size);
+		}
+
+		bool FramePending()
+		{
+			return I2c.pending();
+		}
+
+		int EndFrame(uint8_t* payload, ReadStats& stats)
+		{
+			int status = I2c.result();
+			unsigned int length = payload[1] + 2u; // All of it is clocked, also what did not fit.
+			stats.frames++;
+			stats.transactions++;
+			stats.bytes += length == 2 ? 3 : length;
+			if (!status && payload[1] > MAX_PAYLOAD - 2)
+			{
+				status = ZFORCE_READ_OVERFLOW;
+			}
+			return status;
+		}
+#else
+		int BeginFrame() { return 0; }
+		bool FramePending() { return false; }
+		int EndFrame(uint8_t* payload, ReadStats& stats) { return 0; }
+#endif
+		bool CancelFrame() { return true; }
+
+		uint8_t Address() const { return address; }
+
+	private:
+		uint8_t address;
+		uint8_t* buffer;
+		uint8_t size;
+};
+
+#endif
@@ -0,0 +1,437 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#if(ARDUINO >= 100)
+  #include <Arduino.h>
+#else
+  #include <WProgram.h>
+#endif
+#include "SercomDma.h"
+
+#if ZFORCE_SERCOM_DMA
+
+#define SERCOM_DMA_BUS_ERRORS (I2CM_STATUS_BUSERR | I2CM_STATUS_ARBLOST | I2CM_STATUS_RXNACK)
+
+// The DMAC reads the descriptors of all channels from one table.
+static SercomDmaDescriptor descriptors[ZFORCE_DMA_CHANNELS];
+static SercomDmaDescriptor writeback[ZFORCE_DMA_CHANNELS];
+static SercomDmaDescriptor drainDescriptor;
+
+static void DataReadyHandler()
+{
+  sercomDma.OnDataReady();
+}
+
+extern "C" void DMAC_Handler(void)
+{
+  sercomDma.OnTransferComplete();
+}
+
+SercomDma::SercomDma() : address(0), dataReady(-1), buffer(nullptr), size(0), expectedLength(2),
+  state(SercomDmaState::IDLE), result(0), received(0), writing(false), startedAt(0), callback(nullptr), scratch(0), frameCycles(0), frameTransfers(0), frameBytes(0)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * Takes over the SERCOM set up by Wire.begin(). expectedLength is the length
+ * of the first frame read, later frames are read with the length of the one
+ * before.
+ */
+void SercomDma::Begin(uint8_t address, int dataReady, uint8_t* buffer, uint8_t size, uint8_t expectedLength)
+{
+  this->address = address;
+  this->dataReady = dataReady;
+  this->buffer = buffer;
+  this->size = size;
+  this->expectedLength = expectedLength > size ? size : expectedLength;
+
+  SercomRegisters::Init();
+  SercomRegisters::SetDescriptors(descriptors, writeback);
+  SercomRegisters::Write(DMA_CTRL, SercomRegisters::Read(DMA_CTRL) | DMA_CTRL_DMAENABLE | DMA_CTRL_LVLEN0);
+  SercomRegisters::Write(DMA_CHID, ZFORCE_DMA_CHANNEL);
+  SercomRegisters::Write(DMA_CHCTRLA, 0);
+  SercomRegisters::Write(DMA_CHCTRLA, DMA_CHCTRLA_SWRST);
+  while (SercomRegisters::Read(DMA_CHCTRLA) & DMA_CHCTRLA_SWRST);
+  SercomRegisters::Write(DMA_CHCTRLB, DMA_CHCTRLB_TRIGSRC(ZFORCE_SERCOM_DMA_TRIGGER) | DMA_CHCTRLB_TRIGACT_BEAT);
+  SercomRegisters::Write(DMA_CHINTENSET, DMA_CHINT_TCMPL | DMA_CHINT_TERR);
+
+  // Smart mode acknowledges a byte when the DMAC reads DATA. CTRLB is enable protected.
+  uint32_t ctrla = SercomRegisters::Read(I2CM_CTRLA);
+  SercomRegisters::Write(I2CM_CTRLA, ctrla & ~I2CM_CTRLA_ENABLE);
+  while (SercomRegisters::Read(I2CM_SYNCBUSY) & I2CM_SYNCBUSY_ENABLE);
+  SercomRegisters::Write(I2CM_CTRLB, SercomRegisters::Read(I2CM_CTRLB) | I2CM_CTRLB_SMEN);
+  SercomRegisters::Write(I2CM_CTRLA, ctrla | I2CM_CTRLA_ENABLE);
+  while (SercomRegisters::Read(I2CM_SYNCBUSY) & I2CM_SYNCBUSY_ENABLE);
+  SercomRegisters::Write(I2CM_STATUS, I2CM_STATUS_BUSSTATE_IDLE);
+  Sync();
+
+  attachInterrupt(digitalPinToInterrupt(dataReady), DataReadyHandler, RISING);
+}
+
+void SercomDma::SetCallback(void (*callback)(void))
+{
+  this->callback = callback;
+}
+
+/*
+ * Reads the next frame as soon as data ready is HIGH, right away if it already
+ * is. Returns false if a blocking Read() is in progress.
+ */
+bool SercomDma::Arm()
+{
+  noInterrupts();
+  if (state == SercomDmaState::IDLE)
+  {
+    state = SercomDmaState::ARMED;
+    if (!writing && digitalRead(dataReady) == HIGH)
+    {
+      StartFrame();
+    }
+  }
+  bool armed = state != SercomDmaState::IDLE && state != SercomDmaState::TRANSFER;
+  interrupts();
+
+  return armed;
+}
+
+bool SercomDma::Disarm()
+{
+  noInterrupts();
+  if (state == SercomDmaState::ARMED)
+  {
+    state = SercomDmaState::IDLE;
+  }
+  interrupts();
+
+  SercomDmaState current;
+  while ((current = Poll()) == SercomDmaState::FRAME || current == SercomDmaState::CONTINUATION)
+  {
+    yield();
+  }
+
+  return current != SercomDmaState::READY;
+}
+
+/*
+ * Checks a transfer in progress for bus errors and the timeout, which the DMAC
+ * would otherwise wait out forever, and returns the state.
+ */
+SercomDmaState SercomDma::Poll()
+{
+  SercomDmaState current = state;
+  if (current == SercomDmaState::FRAME || current == SercomDmaState::CONTINUATION || current == SercomDmaState::TRANSFER)
+  {
+    int status = 0;
+    if (SercomRegisters::Read(I2CM_STATUS) & SERCOM_DMA_BUS_ERRORS)
+    {
+      status = SERCOM_DMA_ERROR;
+    }
+    else if (millis() - startedAt >= SERCOM_DMA_TIMEOUT)
+    {
+      status = SERCOM_DMA_TIMEDOUT;
+    }
+
+    noInterrupts();
+    if (status && state == current)
+    {
+      Abort(status);
+    }
+    interrupts();
+  }
+
+  return state;
+}
+
+// 0 once the frame of a READY state was read completely, otherwise the error.
+int SercomDma::Result() const
+{
+  return result;
+}
+
+void SercomDma::Release()
+{
+  noInterrupts();
+  if (state == SercomDmaState::READY)
+  {
+    state = SercomDmaState::IDLE;
+  }
+  interrupts();
+}
+
+/*
+ * Blocking read of count bytes, one DMA transfer. A frame read from data ready
+ * is waited for first; false, i.e. SERCOM_DMA_ERROR, if one is READY.
+ */
+int SercomDma::Read(uint8_t* data, uint8_t count)
+{
+  if (!Disarm() || count == 0)
+  {
+    return SERCOM_DMA_ERROR;
+  }
+
+  noInterrupts();
+  state = SercomDmaState::TRANSFER;
+  StartTransfer(data, count, 0);
+  interrupts();
+
+  while (Poll() == SercomDmaState::TRANSFER)
+  {
+    yield();
+  }
+
+  int status = result;
+  state = SercomDmaState::IDLE;
+
+  return status;
+}
+
+/*
+ * Writes a request by polling the SERCOM. Returns 0 on success, otherwise the
+ * codes of Wire.endTransmission(): 2 address NACK, 3 data NACK, 4 other error.
+ */
+int SercomDma::Write(const uint8_t* data, uint8_t length)
+{
+  SercomDmaState current;
+  while ((current = Poll()) == SercomDmaState::FRAME || current == SercomDmaState::CONTINUATION)
+  {
+    yield();
+  }
+
+  writing = true;
+  SercomRegisters::Write(I2CM_ADDR, (uint32_t)address << 1);
+  Sync();
+  int status = WaitForBus(I2CM_INTFLAG_MB);
+  if (!status && (SercomRegisters::Read(I2CM_STATUS) & I2CM_STATUS_RXNACK))
+  {
+    status = 2;
+  }
+  for (uint8_t i = 0; !status && i < length; i++)
+  {
+    SercomRegisters::Write(I2CM_DATA, data[i]);
+    Sync();
+    status = WaitForBus(I2CM_INTFLAG_MB);
+    if (!status && (SercomRegisters::Read(I2CM_STATUS) & I2CM_STATUS_RXNACK))
+    {
+      status = 3;
+    }
+  }
+  SercomRegisters::Write(I2CM_CTRLB, SercomRegisters::Read(I2CM_CTRLB) | I2CM_CTRLB_CMD_STOP);
+  Sync();
+  writing = false;
+
+  // A frame that became ready during the write has not been started yet.
+  noInterrupts();
+  if (state == SercomDmaState::ARMED && digitalRead(dataReady) == HIGH)
+  {
+    StartFrame();
+  }
+  interrupts();
+
+  return status;
+}
+
+const SercomDmaStats& SercomDma::Stats() const
+{
+  return stats;
+}
+
+void SercomDma::ResetStats()
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
+void SercomDma::OnDataReady()
+{
+  stats.interrupts++;
+  if (state == SercomDmaState::ARMED && !writing)
+  {
+    StartFrame();
+  }
+}
+
+/*
+ * Transfer complete: a frame longer than the transfer gets a second one for the
+ * rest, everything else ends in READY.
+ */
+void SercomDma::OnTransferComplete()
+{
+  uint32_t start = SercomRegisters::Cycles();
+  stats.interrupts++;
+  SercomRegisters::Write(DMA_CHID, ZFORCE_DMA_CHANNEL);
+  uint8_t flags = SercomRegisters::Read(DMA_CHINTFLAG);
+  SercomRegisters::Write(DMA_CHINTFLAG, flags);
+
+  bool frame = state == SercomDmaState::FRAME || state == SercomDmaState::CONTINUATION;
+  if (flags & DMA_CHINT_TERR)
+  {
+    Abort(SERCOM_DMA_ERROR);
+  }
+  else if ((flags & DMA_CHINT_TCMPL) && state == SercomDmaState::FRAME)
+  {
+    uint16_t total = buffer[1] + 2;
+    uint8_t fits = total > size ? size : total;
+    if (total > received)
+    {
+      stats.continuations++;
+      state = SercomDmaState::CONTINUATION;
+      StartTransfer(buffer + received, fits - received, total - fits);
+      frameTransfers++;
+      frameBytes += total - received;
+      received = fits;
+    }
+    else
+    {
+      state = SercomDmaState::READY;
+    }
+    expectedLength = fits;
+  }
+  else if (flags & DMA_CHINT_TCMPL)
+  {
+    if (state == SercomDmaState::CONTINUATION || state == SercomDmaState::TRANSFER)
+    {
+      state = SercomDmaState::READY;
+    }
+  }
+
+  frameCycles += SercomRegisters::Cycles() - start;
+  if (frame && state == SercomDmaState::READY)
+  {
+    if (!result)
+    {
+      stats.frames++;
+    }
+    stats.lastCycles = frameCycles;
+    stats.lastTransfers = frameTransfers;
+    stats.lastBytes = frameBytes;
+    stats.cycles += frameCycles;
+    if (callback)
+    {
+      callback();
+    }
+  }
+}
+
+// Called with interrupts disabled, or from a handler.
+void SercomDma::StartFrame()
+{
+  uint32_t start = SercomRegisters::Cycles();
+  frameCycles = 0;
+  frameTransfers = 1;
+  frameBytes = expectedLength;
+  received = expectedLength;
+  StartTransfer(buffer, expectedLength, 0);
+  state = SercomDmaState::FRAME;
+  frameCycles += SercomRegisters::Cycles() - start;
+}
+
+/*
+ * Reads count bytes into data followed by drain bytes into the scratch byte, as
+ * one transaction that the SERCOM ends with a NACK and STOP after the last byte.
+ * Only the last block raises the transfer complete interrupt.
+ */
+void SercomDma::StartTransfer(uint8_t* data, uint8_t count, uint8_t drain)
+{
+  SercomDmaDescriptor* first = &descriptors[ZFORCE_DMA_CHANNEL];
+  SercomDmaDescriptor* last = first;
+  if (count > 0)
+  {
+    first->btctrl = DMA_BTCTRL_VALID | DMA_BTCTRL_DSTINC;
+    first->btcnt = count;
+    first->srcaddr = SercomRegisters::DataRegister();
+    first->dstaddr = (uintptr_t)(data + count);
+    first->descaddr = 0;
+    if (drain > 0)
+    {
+      first->descaddr = (uintptr_t)&drainDescriptor;
+      last = &drainDescriptor;
+    }
+  }
+  if (drain > 0)
+  {
+    last->btctrl = DMA_BTCTRL_VALID;
+    last->btcnt = drain;
+    last->srcaddr = SercomRegisters::DataRegister();
+    last->dstaddr = (uintptr_t)&scratch;
+    last->descaddr = 0;
+  }
+  last->btctrl |= DMA_BTCTRL_BLOCKACT_INT;
+
+  result = 0;
+  startedAt = millis();
+  SercomRegisters::Write(DMA_CHID, ZFORCE_DMA_CHANNEL);
+  SercomRegisters::Write(DMA_CHINTFLAG, DMA_CHINT_TCMPL | DMA_CHINT_TERR);
+  SercomRegisters::Write(DMA_CHCTRLA, DMA_CHCTRLA_ENABLE);
+  SercomRegisters::Write(I2CM_ADDR, ((uint32_t)address << 1) | 0x01 | I2CM_ADDR_LENEN | I2CM_ADDR_LEN(count + drain));
+  Sync();
+}
+
+void SercomDma::Abort(int status)
+{
+  SercomRegisters::Write(DMA_CHID, ZFORCE_DMA_CHANNEL);
+  SercomRegisters::Write(DMA_CHCTRLA, 0);
+  SercomRegisters::Write(I2CM_CTRLB, SercomRegisters::Read(I2CM_CTRLB) | I2CM_CTRLB_CMD_STOP);
+  Sync();
+  SercomRegisters::Write(I2CM_STATUS, I2CM_STATUS_BUSSTATE_IDLE);
+  Sync();
+
+  if (status == SERCOM_DMA_TIMEDOUT)
+  {
+    stats.timeouts++;
+  }
+  else
+  {
+    stats.errors++;
+  }
+  result = status;
+  state = SercomDmaState::READY;
+}
+
+int SercomDma::WaitForBus(uint8_t flag)
+{
+  unsigned long start = millis();
+  uint8_t flags;
+  while (!((flags = SercomRegisters::Read(I2CM_INTFLAG)) & (flag | I2CM_INTFLAG_ERROR)))
+  {
+    if (millis() - start >= SERCOM_DMA_TIMEOUT)
+    {
+      return 4;
+    }
+    yield();
+  }
+  if (flags & I2CM_INTFLAG_ERROR)
+  {
+    SercomRegisters::Write(I2CM_INTFLAG, I2CM_INTFLAG_ERROR);
+    return 4;
+  }
+
+  return 0;
+}
+
+void SercomDma::Sync()
+{
+  while (SercomRegisters::Read(I2CM_SYNCBUSY) & I2CM_SYNCBUSY_SYSOP);
+}
+
+SercomDma sercomDma;
+
+#endif
@@ -0,0 +1,110 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "SercomRegisters.h"
+
+#if ZFORCE_SERCOM_DMA
+
+#define SERCOM_DMA_TIMEOUT 25 // ms, longer than the longest frame takes at 100 kHz
+#define SERCOM_DMA_ERROR -4   // Bus error, lost arbitration or a NACK while reading.
+#define SERCOM_DMA_TIMEDOUT -5
+
+enum class SercomDmaState
+{
+	IDLE = 0,
+	ARMED = 1,        // Waiting for the data ready edge.
+	FRAME = 2,        // Reading a frame of the expected length.
+	CONTINUATION = 3, // Reading the rest of a frame longer than expected.
+	READY = 4,        // A frame is in the buffer, see Result().
+	TRANSFER = 5      // A blocking Read() is in progress.
+};
+
+typedef struct SercomDmaStats
+{
+	unsigned long frames;
+	unsigned long continuations; // Frames that needed a second transfer.
+	unsigned long errors;
+	unsigned long timeouts;
+	unsigned long interrupts;    // Data ready and transfer complete handler runs.
+	unsigned long cycles;        // CPU cycles spent in the handlers and in starting transfers.
+	unsigned long lastCycles;    // The same, for the last frame.
+	uint8_t lastTransfers;       // Transfers of the last frame, 2 if it needed a continuation.
+	uint8_t lastBytes;           // Bytes clocked for the last frame, padding included.
+} SercomDmaStats;
+
+/*
+ * Frame reads through the SAMD21 DMAC. Once armed, the rising edge of data
+ * ready starts a DMA transfer of the length of the previous frame straight into
+ * the parse buffer, with the SERCOM ending the transaction by itself after that
+ * many bytes (ADDR.LENEN). The transfer complete interrupt then either finishes
+ * the frame or, for a longer frame, starts a second transfer for the rest, the
+ * part past the buffer being drained into a scratch byte. The CPU takes one
+ * interrupt per frame instead of polling every byte.
+ *
+ * Requests are short and are written by polling the SERCOM, which is not used
+ * through Wire after Begin().
+ */
+class SercomDma
+{
+	public:
+		SercomDma();
+		void Begin(uint8_t address, int dataReady, uint8_t* buffer, uint8_t size, uint8_t expectedLength);
+		// Called from the interrupt once a frame is READY; the data ready interrupt belongs to the transport.
+		void SetCallback(void (*callback)(void));
+		bool Arm();
+		// Cancels an armed read and waits for a frame in flight. False if a frame is READY.
+		bool Disarm();
+		SercomDmaState Poll();
+		int Result() const;
+		void Release();
+		int Read(uint8_t* data, uint8_t count);
+		int Write(const uint8_t* data, uint8_t length);
+		const SercomDmaStats& Stats() const;
+		void ResetStats();
+		void OnDataReady();
+		void OnTransferComplete();
+	private:
+		void StartFrame();
+		void StartTransfer(uint8_t* data, uint8_t count, uint8_t drain);
+		void Abort(int status);
+		int WaitForBus(uint8_t flag);
+		void Sync();
+		uint8_t address;
+		int dataReady;
+		uint8_t* buffer;
+		uint8_t size;
+		uint8_t expectedLength;
+		volatile SercomDmaState state;
+		volatile int result;
+		volatile uint8_t received;
+		volatile bool writing;
+		volatile unsigned long startedAt;
+		void (*callback)(void);
+		uint8_t scratch;
+		uint32_t frameCycles;
+		uint8_t frameTransfers;
+		uint8_t frameBytes;
+		SercomDmaStats stats;
+};
+
+extern SercomDma sercomDma;
+
+#endif
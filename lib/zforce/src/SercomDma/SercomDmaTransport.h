@@ -0,0 +1,122 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "../Zforce.h"
+#include "SercomDma.h"
+
+#if ZFORCE_SERCOM_DMA
+
+/*
+ * Sensor on the SAMD21 SERCOM with frames read by the DMAC from the data
+ * ready edge, see SercomDma. There is one SercomDma engine, so all
+ * SercomDmaTransport objects share it.
+ */
+class SercomDmaTransport
+{
+	public:
+		static const bool readsFrames = true;
+		static const bool armsOnDataReady = true;
+		static const uint8_t maxWrite = MAX_PAYLOAD;
+
+		SercomDmaTransport(uint8_t address = ZFORCE_I2C_ADDRESS) : address(address), buffer(nullptr) {}
+
+		void Begin(int dataReady, uint8_t* buffer, uint8_t size)
+		{
+			this->buffer = buffer;
+			sercomDma.Begin(address, dataReady, buffer, size, ZFORCE_INITIAL_READ_LENGTH);
+		}
+
+		int Read(uint8_t* data, uint8_t count, ReadStats& stats)
+		{
+			stats.transactions++;
+			stats.bytes += count;
+			return sercomDma.Read(data, count);
+		}
+
+		int Write(const uint8_t* data, uint8_t length)
+		{
+			return sercomDma.Write(data, length);
+		}
+
+		// The address and a STOP, without data.
+		bool Probe()
+		{
+			return sercomDma.Write(nullptr, 0) == 0;
+		}
+
+		int BeginFrame()
+		{
+			return sercomDma.Arm() ? 0 : SERCOM_DMA_ERROR;
+		}
+
+		// A read cancelled by a blocking Read() in between is not pending either.
+		bool FramePending()
+		{
+			SercomDmaState state = sercomDma.Poll();
+			return state != SercomDmaState::READY && state != SercomDmaState::IDLE;
+		}
+
+		/*
+		 * Accounts for the frame the DMAC has read into the buffer, copies it to
+		 * payload and frees the buffer for the next one.
+		 */
+		int EndFrame(uint8_t* payload, ReadStats& stats)
+		{
+			if (sercomDma.Poll() != SercomDmaState::READY)
+			{
+				return SERCOM_DMA_ERROR;
+			}
+			const SercomDmaStats& dma = sercomDma.Stats();
+			int status = sercomDma.Result();
+			if (!status)
+			{
+				stats.frames++;
+				stats.transactions += dma.lastTransfers;
+				stats.bytes += dma.lastBytes;
+				stats.continuations += dma.lastTransfers > 1 ? 1 : 0;
+				stats.cpuCycles += dma.lastCycles;
+				if (buffer[1] > MAX_PAYLOAD - 2)
+				{
+					status = ZFORCE_READ_OVERFLOW;
+				}
+			}
+			if (payload != buffer)
+			{
+				memcpy(payload, buffer, MAX_PAYLOAD);
+			}
+			sercomDma.Release();
+
+			return status;
+		}
+
+		bool CancelFrame()
+		{
+			return sercomDma.Disarm();
+		}
+
+		uint8_t Address() const { return address; }
+
+	private:
+		uint8_t address;
+		uint8_t* buffer;
+};
+
+#endif
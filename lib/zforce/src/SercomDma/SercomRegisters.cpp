@@ -0,0 +1,108 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "SercomRegisters.h"
+
+#if defined(ARDUINO_ARCH_SAMD) && ZFORCE_SERCOM_DMA
+
+#include <Arduino.h>
+
+void SercomRegisters::Init()
+{
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+  NVIC_EnableIRQ(DMAC_IRQn);
+}
+
+uint32_t SercomRegisters::Read(SercomRegister reg)
+{
+  switch (reg)
+  {
+    case I2CM_CTRLA: return ZFORCE_SERCOM->I2CM.CTRLA.reg;
+    case I2CM_CTRLB: return ZFORCE_SERCOM->I2CM.CTRLB.reg;
+    case I2CM_BAUD: return ZFORCE_SERCOM->I2CM.BAUD.reg;
+    case I2CM_INTFLAG: return ZFORCE_SERCOM->I2CM.INTFLAG.reg;
+    case I2CM_STATUS: return ZFORCE_SERCOM->I2CM.STATUS.reg;
+    case I2CM_SYNCBUSY: return ZFORCE_SERCOM->I2CM.SYNCBUSY.reg;
+    case I2CM_ADDR: return ZFORCE_SERCOM->I2CM.ADDR.reg;
+    case I2CM_DATA: return ZFORCE_SERCOM->I2CM.DATA.reg;
+    case DMA_CTRL: return DMAC->CTRL.reg;
+    case DMA_CHID: return DMAC->CHID.reg;
+    case DMA_CHCTRLA: return DMAC->CHCTRLA.reg;
+    case DMA_CHCTRLB: return DMAC->CHCTRLB.reg;
+    case DMA_CHINTENCLR: return DMAC->CHINTENCLR.reg;
+    case DMA_CHINTENSET: return DMAC->CHINTENSET.reg;
+    case DMA_CHINTFLAG: return DMAC->CHINTFLAG.reg;
+  }
+  return 0;
+}
+
+void SercomRegisters::Write(SercomRegister reg, uint32_t value)
+{
+  switch (reg)
+  {
+    case I2CM_CTRLA: ZFORCE_SERCOM->I2CM.CTRLA.reg = value; break;
+    case I2CM_CTRLB: ZFORCE_SERCOM->I2CM.CTRLB.reg = value; break;
+    case I2CM_BAUD: ZFORCE_SERCOM->I2CM.BAUD.reg = value; break;
+    case I2CM_INTFLAG: ZFORCE_SERCOM->I2CM.INTFLAG.reg = value; break;
+    case I2CM_STATUS: ZFORCE_SERCOM->I2CM.STATUS.reg = value; break;
+    case I2CM_SYNCBUSY: break; // read only
+    case I2CM_ADDR: ZFORCE_SERCOM->I2CM.ADDR.reg = value; break;
+    case I2CM_DATA: ZFORCE_SERCOM->I2CM.DATA.reg = value; break;
+    case DMA_CTRL: DMAC->CTRL.reg = value; break;
+    case DMA_CHID: DMAC->CHID.reg = value; break;
+    case DMA_CHCTRLA: DMAC->CHCTRLA.reg = value; break;
+    case DMA_CHCTRLB: DMAC->CHCTRLB.reg = value; break;
+    case DMA_CHINTENCLR: DMAC->CHINTENCLR.reg = value; break;
+    case DMA_CHINTENSET: DMAC->CHINTENSET.reg = value; break;
+    case DMA_CHINTFLAG: DMAC->CHINTFLAG.reg = value; break;
+  }
+}
+
+void SercomRegisters::SetDescriptors(SercomDmaDescriptor* base, SercomDmaDescriptor* writeback)
+{
+  DMAC->BASEADDR.reg = (uint32_t)base;
+  DMAC->WRBADDR.reg = (uint32_t)writeback;
+}
+
+uintptr_t SercomRegisters::DataRegister()
+{
+  return (uintptr_t)&ZFORCE_SERCOM->I2CM.DATA.reg;
+}
+
+/*
+ * SysTick counts down from LOAD once per CPU cycle and wraps every millisecond.
+ * In a handler that blocks the SysTick interrupt a wrap may be missed, which
+ * costs one millisecond of accuracy in rare measurements.
+ */
+uint32_t SercomRegisters::Cycles()
+{
+  uint32_t ms;
+  uint32_t value;
+  do
+  {
+    ms = millis();
+    value = SysTick->VAL;
+  } while (ms != millis());
+
+  return ms * (SysTick->LOAD + 1) + (SysTick->LOAD - value);
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/*
+ * Register access layer of the SAMD21 SERCOM I2C master and DMAC channel used
+ * by SercomDma. On the board SercomRegisters.cpp maps every register to its
+ * CMSIS definition; host builds link a model of the two peripherals instead
+ * (lib/ArduinoHost/src/HostSercom.cpp), so the transport runs unchanged on
+ * both. Register and bit names follow the data sheet.
+ */
+
+// Enables the DMA transport. Reads and writes then go through the SERCOM that
+// Wire.begin() has set up, which must not be used through Wire afterwards.
+#ifndef ZFORCE_SERCOM_DMA
+#define ZFORCE_SERCOM_DMA 0
+#endif
+
+#ifndef ZFORCE_SERCOM
+#define ZFORCE_SERCOM SERCOM3 // Wire on the neonode prototype board
+#endif
+#ifndef ZFORCE_SERCOM_DMA_TRIGGER
+#define ZFORCE_SERCOM_DMA_TRIGGER 0x07 // SERCOM3_DMAC_ID_RX
+#endif
+#ifndef ZFORCE_DMA_CHANNEL
+#define ZFORCE_DMA_CHANNEL 0
+#endif
+#define ZFORCE_DMA_CHANNELS 12
+
+enum SercomRegister
+{
+	I2CM_CTRLA,
+	I2CM_CTRLB,
+	I2CM_BAUD,
+	I2CM_INTFLAG,
+	I2CM_STATUS,
+	I2CM_SYNCBUSY,
+	I2CM_ADDR,
+	I2CM_DATA,
+	DMA_CTRL,
+	DMA_CHID,
+	DMA_CHCTRLA,
+	DMA_CHCTRLB,
+	DMA_CHINTENCLR,
+	DMA_CHINTENSET,
+	DMA_CHINTFLAG
+};
+
+#define I2CM_CTRLA_ENABLE       (1UL << 1)
+#define I2CM_CTRLB_SMEN         (1UL << 8)
+#define I2CM_CTRLB_CMD_STOP     (3UL << 16)
+#define I2CM_CTRLB_ACKACT       (1UL << 18)
+#define I2CM_INTFLAG_MB         0x01
+#define I2CM_INTFLAG_SB         0x02
+#define I2CM_INTFLAG_ERROR      0x80
+#define I2CM_STATUS_BUSERR      (1UL << 0)
+#define I2CM_STATUS_ARBLOST     (1UL << 1)
+#define I2CM_STATUS_RXNACK      (1UL << 2)
+#define I2CM_STATUS_BUSSTATE    (3UL << 4)
+#define I2CM_STATUS_BUSSTATE_IDLE (1UL << 4)
+#define I2CM_STATUS_LENERR      (1UL << 10)
+#define I2CM_SYNCBUSY_ENABLE    (1UL << 1)
+#define I2CM_SYNCBUSY_SYSOP     (1UL << 2)
+#define I2CM_ADDR_LENEN         (1UL << 13)
+#define I2CM_ADDR_LEN(count)    ((uint32_t)(count) << 16)
+
+#define DMA_CTRL_DMAENABLE      (1UL << 1)
+#define DMA_CTRL_LVLEN0         (1UL << 8)
+#define DMA_CHCTRLA_SWRST       (1UL << 0)
+#define DMA_CHCTRLA_ENABLE      (1UL << 1)
+#define DMA_CHCTRLB_TRIGSRC(id) ((uint32_t)(id) << 8)
+#define DMA_CHCTRLB_TRIGACT_BEAT (2UL << 22)
+#define DMA_CHINT_TERR          0x01
+#define DMA_CHINT_TCMPL         0x02
+
+#define DMA_BTCTRL_VALID        (1U << 0)
+#define DMA_BTCTRL_BLOCKACT_INT (1U << 3)
+#define DMA_BTCTRL_DSTINC       (1U << 11)
+
+/*
+ * Transfer descriptor as read by the DMAC. With DSTINC, dstaddr holds the
+ * address just past the last byte, as required by the hardware. The layout
+ * matches the hardware on the 32 bit target, where the descriptors have to be
+ * 16 byte aligned.
+ */
+typedef struct SercomDmaDescriptor
+{
+	uint16_t btctrl;
+	uint16_t btcnt;
+	uintptr_t srcaddr;
+	uintptr_t dstaddr;
+	uintptr_t descaddr;
+} __attribute__((aligned(16))) SercomDmaDescriptor;
+
+namespace SercomRegisters
+{
+	// Clocks the DMAC and enables its interrupt.
+	void Init();
+	uint32_t Read(SercomRegister reg);
+	void Write(SercomRegister reg, uint32_t value);
+	// Base of the descriptors of all channels and of their write back copies.
+	void SetDescriptors(SercomDmaDescriptor* base, SercomDmaDescriptor* writeback);
+	// Address of the I2CM DATA register, the source of the receive transfers.
+	uintptr_t DataRegister();
+	// Free running count of CPU cycles, to measure the time spent in handlers.
+	uint32_t Cycles();
+}
@@ -0,0 +1,107 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "Zforce.h"
+#include <Wire.h>
+
+// Largest transfer the Wire core can stage, 32 bytes on AVR.
+#if defined(BUFFER_LENGTH) && BUFFER_LENGTH < MAX_PAYLOAD
+  #define ZFORCE_WIRE_CHUNK BUFFER_LENGTH
+#else
+  #define ZFORCE_WIRE_CHUNK MAX_PAYLOAD
+#endif
+
+/*
+ * Sensor on the Wire bus. Wire stages every transfer in its own buffer, so
+ * longer reads are split into transactions of ZFORCE_WIRE_CHUNK bytes; the
+ * sensor carries on where the previous transaction stopped. There are no
+ * background reads, BeginRead() reads the whole frame.
+ */
+class WireTransport
+{
+	public:
+		static const bool readsFrames = false;
+		static const bool armsOnDataReady = false;
+		static const uint8_t maxWrite = ZFORCE_WIRE_CHUNK;
+
+		WireTransport(uint8_t address = ZFORCE_I2C_ADDRESS) : address(address) {}
+
+		void Begin(int dataReady, uint8_t* buffer, uint8_t size)
+		{
+			Wire.begin();
+		}
+
+		int Read(uint8_t* data, uint8_t count, ReadStats& stats)
+		{
+			uint8_t received = 0;
+			while (received < count)
+			{
+				uint8_t chunk = count - received > ZFORCE_WIRE_CHUNK ? ZFORCE_WIRE_CHUNK : count - received;
+				uint8_t end = received + chunk;
+				stats.transactions++;
+				stats.bytes += chunk;
+				Wire.requestFrom((int)address, (int)chunk);
+				while (Wire.available())
+				{
+					uint8_t value = Wire.read();
+					if (received < end)
+					{
+						data[received++] = value;
+					}
+				}
+				if (received < end)
+				{
+					return ZFORCE_READ_TRUNCATED;
+				}
+			}
+
+			return 0;
+		}
+
+		int Write(const uint8_t* data, uint8_t length)
+		{
+			if (length > ZFORCE_WIRE_CHUNK) // A request has to go in one transaction.
+			{
+				return ZFORCE_WRITE_OVERFLOW;
+			}
+
+			Wire.beginTransmission(address);
+			Wire.write(data, length);
+
+			return Wire.endTransmission(); // 0 if success, otherwise the error code of the Wire library
+		}
+
+		bool Probe()
+		{
+			Wire.beginTransmission(address);
+			return Wire.endTransmission() == 0;
+		}
+
+		int BeginFrame() { return 0; }
+		bool FramePending() { return false; }
+		int EndFrame(uint8_t* payload, ReadStats& stats) { return 0; }
+		bool CancelFrame() { return true; }
+
+		uint8_t Address() const { return address; }
+
+	private:
+		uint8_t address;
+};
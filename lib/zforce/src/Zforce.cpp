@@ -20,209 +20,403 @@
 
 #include <string.h>
 #include <inttypes.h>
-#include "I2C/I2C.h"
 #include "Zforce.h"
-#if USE_I2C_LIB == 0
-  #include <Wire.h>
-  #if(ARDUINO >= 100)
-    #include <Arduino.h>
-  #else
-    #include <WProgram.h>
-  #endif
-#endif
-
-Zforce::Zforce()
-{
-}
+#include "Ber.h"
+#include "BerEncoder.h"
 
-void Zforce::Start(int dr)
-{
-  dataReady = dr;
-  pinMode(dataReady, INPUT);
-#if USE_I2C_LIB == 1
-  I2c.setSpeed(1);
-  I2c.begin();
-#else
-  Wire.begin();
-#endif
-}
+/*
+ * Request frames, see BerEncoder.h. Requests with only boolean arguments are
+ * constant frames, one per value.
+ */
+template <bool Enabled>
+using EnableRequest = ZforceRequest<BerSequence<0x65, BerNull<Enabled ? 0x81 : 0x80> > >;
 
-int Zforce::Read(uint8_t * payload)
-{
-#if USE_I2C_LIB == 1
-  int status = 0;
-
-  status = I2c.read(ZFORCE_I2C_ADDRESS, 2);
-
-  // Read the 2 I2C header bytes.
-  payload[0] = I2c.receive();
-  payload[1] = I2c.receive();
-
-  status = I2c.read(ZFORCE_I2C_ADDRESS, payload[1], &payload[2]);
-
-  return status; // return 0 if success, otherwise error code according to Atmel Data Sheet
-#else
-  Wire.requestFrom(ZFORCE_I2C_ADDRESS, 2);
-  payload[0] = Wire.read();
-  payload[1] = Wire.read();
-  
-  int index = 2;
-  Wire.requestFrom(ZFORCE_I2C_ADDRESS, payload[1]);
-  while (Wire.available())
-  {
-    payload[index++] = Wire.read();
-  }
-  
-  return 0;
-#endif
-}
+typedef ZforceRequest<BerSequence<0x73, BerSequence<0xA2,
+                        BerUint16<0x80>, BerUint16<0x81>, BerUint16<0x82>, BerUint16<0x83> > > > TouchActiveAreaRequest;
+
+template <bool Reversed>
+using ReverseXRequest = ZforceRequest<BerSequence<0x73, BerSequence<0xA2, BerConstant<0x84, Reversed ? 0xFF : 0x00> > > >;
+
+template <bool Reversed>
+using ReverseYRequest = ZforceRequest<BerSequence<0x73, BerSequence<0xA2, BerConstant<0x85, Reversed ? 0xFF : 0x00> > > >;
+
+template <bool Flipped>
+using FlipXYRequest = ZforceRequest<BerSequence<0x73, BerSequence<0xA2, BerConstant<0x86, Flipped ? 0xFF : 0x00> > > >;
+
+typedef ZforceRequest<BerSequence<0x73, BerUint8<0x86> > > ReportedTouchesRequest;
+
+#define MAX_CONFIGURATION_REQUEST 40 // Every setting present: 4 integers, 3 booleans and reported touches.
 
 /*
- * Sends a message in the form of a byte array.
+ * Decoders for the content of a frame, looked up by the frame tag (0xEF response,
+ * 0xF0 notification) and the tag of the content that follows the device address.
+ * Each returns false if the content is malformed.
  */
-int Zforce::Write(uint8_t* payload)
+typedef bool (*ContentDecoder)(MessageVariant& msg, const BerTlv& content);
+
+typedef struct ContentDecoderEntry
 {
-#if USE_I2C_LIB == 1
-  int len = payload[1] + 1;
-  int status = I2c.write(ZFORCE_I2C_ADDRESS, payload[0], &payload[1], len);
-
-  return status; // return 0 if success, otherwise error code according to Atmel Data Sheet
-#else
-  Wire.beginTransmission(ZFORCE_I2C_ADDRESS);
-  Wire.write(payload, payload[1] + 2);
-  Wire.endTransmission();
-
-  return 0;
-#endif
-}
+  uint8_t frameTag;
+  uint8_t contentTag;
+  ContentDecoder decode;
+} ContentDecoderEntry;
+
+#define TOUCH_ELEMENT_SIZE 11 // tag, length, id, event, x, y and three more bytes
 
-bool Zforce::Enable(bool isEnabled)
+static void DecodeTouchValue(TouchData& data, const uint8_t* value)
 {
-  bool failed = false;
+  data.id = value[0];
+  data.event = (TouchEvent)value[1];
+  data.x = (value[2] << 8) | value[3];
+  data.y = (value[4] << 8) | value[5];
+}
 
-  uint8_t enable[] = {0xEE, 0x0A, 0xEE, 0x08, 0x40, 0x02, 0x02, 0x00, 0x65, 0x02, (uint8_t)(isEnabled ? 0x81 : 0x80), 0x00};
+/*
+ * The sensor sends touches as equally sized elements. When the content length
+ * says so, every element position is known up front and only the length byte
+ * of each needs checking, which avoids walking the elements one by one. The
+ * checks are collected and tested once; if any fails the caller falls back to
+ * the element walk, which overwrites whatever was decoded here.
+ */
+static bool DecodeUniformTouches(MessageVariant& msg, const BerTlv& content)
+{
+  if (content.length % TOUCH_ELEMENT_SIZE != 0)
+  {
+    return false;
+  }
 
-  if (Write(enable)) // We assume that the end user has called GetMessage prior to calling this method
+  uint8_t count = content.length / TOUCH_ELEMENT_SIZE;
+  if (count > MAX_REPORTED_TOUCHES)
   {
-    failed = true;
+    count = MAX_REPORTED_TOUCHES;
   }
-  else
+
+  const uint8_t* element = content.value;
+  uint8_t mismatch = 0;
+  for (uint8_t i = 0; i < count; i++, element += TOUCH_ELEMENT_SIZE)
   {
-    lastSentMessage = MessageType::ENABLETYPE;
+    mismatch |= element[1] ^ (TOUCH_ELEMENT_SIZE - 2);
+    DecodeTouchValue(msg.touch.touchData[i], &element[2]);
   }
 
-  return !failed;
+  msg.touch.touchCount = count;
+  return mismatch == 0;
 }
 
-bool Zforce::TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY)
+static bool DecodeTouch(MessageVariant& msg, const BerTlv& content)
 {
-  bool failed = false;
+  msg.type = MessageType::TOUCHTYPE;
 
-  const uint8_t length = 16;
-
-  uint8_t touchActiveArea[] = {0xEE, length + 10, 0xEE, length + 8,
-                               0x40, 0x02, 0x02, 0x00, 0x73, length + 2, 0xA2, length,
-                               0x80, 02, (uint8_t)(minX >> 8), (uint8_t)(minX & 0xFF),
-                               0x81, 02, (uint8_t)(minY >> 8), (uint8_t)(minY & 0xFF),
-                               0x82, 02, (uint8_t)(maxX >> 8), (uint8_t)(maxX & 0xFF),
-                               0x83, 02, (uint8_t)(maxY >> 8), (uint8_t)(maxY & 0xFF)};
-
-  if (Write(touchActiveArea)) // We assume that the end user has called GetMessage prior to calling this method
+  if (DecodeUniformTouches(msg, content))
   {
-    failed = true;
+    return true;
   }
-  else
+
+  BerReader touches(content);
+  BerTlv touch;
+  uint8_t count = 0;
+
+  while (touches.Next(touch))
   {
-    lastSentMessage = MessageType::TOUCHACTIVEAREATYPE;
+    if (touch.length < 6) // id, event, x and y
+    {
+      return false;
+    }
+    if (count < MAX_REPORTED_TOUCHES)
+    {
+      DecodeTouchValue(msg.touch.touchData[count++], touch.value);
+    }
   }
 
-  return !failed;
+  msg.touch.touchCount = count;
+  return !touches.IsMalformed();
 }
 
-bool Zforce::FlipXY(bool isFlipped)
+static bool DecodeBootComplete(MessageVariant& msg, const BerTlv& content)
 {
-  bool failed = false;
+  msg.type = MessageType::BOOTCOMPLETETYPE;
+  return true;
+}
 
-  uint8_t flipXY[] = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x86, 0x01, (uint8_t)(isFlipped ? 0xFF : 0x00)};
+static bool DecodeEnable(MessageVariant& msg, const BerTlv& content)
+{
+  BerReader fields(content);
+  BerTlv field;
 
-  if (Write(flipXY)) // We assume that the end user has called GetMessage prior to calling this method
+  if (!fields.Next(field))
   {
-    failed = true;
+    return false;
   }
-  else
+
+  if (field.tag == 0x80 || field.tag == 0x81)
   {
-    lastSentMessage = MessageType::FLIPXYTYPE;
+    msg.type = MessageType::ENABLETYPE;
+    msg.enabled = field.tag == 0x81;
   }
 
-  return !failed;
+  return true;
 }
 
-bool Zforce::ReverseX(bool isReversed)
+/*
+ * Picks up one sub touch active area field of a device configuration response.
+ */
+static void DecodeConfigurationField(DeviceConfiguration& config, const BerTlv& subField)
 {
-  bool failed = false;
+  switch (subField.tag)
+  {
+    case 0x80: config.touchActiveArea.minX = BerInteger(subField); config.fields |= CONFIG_TOUCH_ACTIVE_AREA; break;
+    case 0x81: config.touchActiveArea.minY = BerInteger(subField); config.fields |= CONFIG_TOUCH_ACTIVE_AREA; break;
+    case 0x82: config.touchActiveArea.maxX = BerInteger(subField); config.fields |= CONFIG_TOUCH_ACTIVE_AREA; break;
+    case 0x83: config.touchActiveArea.maxY = BerInteger(subField); config.fields |= CONFIG_TOUCH_ACTIVE_AREA; break;
+    case 0x84: config.reverseX = BerBoolean(subField); config.fields |= CONFIG_REVERSE_X; break;
+    case 0x85: config.reverseY = BerBoolean(subField); config.fields |= CONFIG_REVERSE_Y; break;
+    case 0x86: config.flipXY = BerBoolean(subField); config.fields |= CONFIG_FLIP_XY; break;
+    default: break;
+  }
+}
 
-  uint8_t reverseX[] = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x84, 0x01, (uint8_t)(isReversed ? 0xFF : 0x00)};
+/*
+ * A device configuration response carries the sub touch active area (0xA2) and
+ * the top level settings that were set. The message type follows from what the
+ * response holds: a single setting gives the message type of its own request,
+ * several give DEVICECONFIGURATIONTYPE and none NONE.
+ */
+static bool DecodeDeviceConfiguration(MessageVariant& msg, const BerTlv& content)
+{
+  BerReader fields(content);
+  BerTlv field;
+  DeviceConfiguration config;
+  memset(&config, 0, sizeof(config));
 
-  if (Write(reverseX)) // We assume that the end user has called GetMessage prior to calling this method
+  while (fields.Next(field))
   {
-    failed = true;
+    if (field.tag == 0xA2)
+    {
+      BerReader subFields(field);
+      BerTlv subField;
+      while (subFields.Next(subField))
+      {
+        DecodeConfigurationField(config, subField);
+      }
+      if (subFields.IsMalformed())
+      {
+        return false;
+      }
+    }
+    else if (field.tag == 0x86)
+    {
+      config.reportedTouches = (uint8_t)BerInteger(field);
+      config.fields |= CONFIG_REPORTED_TOUCHES;
+    }
   }
-  else
+
+  if (fields.IsMalformed())
   {
-    lastSentMessage = MessageType::REVERSEXTYPE;
+    return false;
   }
 
-  return !failed;
+  switch (config.fields)
+  {
+    case 0:
+      msg.type = MessageType::NONE;
+    break;
+    case CONFIG_TOUCH_ACTIVE_AREA:
+      msg.type = MessageType::TOUCHACTIVEAREATYPE;
+      msg.touchActiveArea = config.touchActiveArea;
+    break;
+    case CONFIG_REVERSE_X:
+      msg.type = MessageType::REVERSEXTYPE;
+      msg.reversed = config.reverseX;
+    break;
+    case CONFIG_REVERSE_Y:
+      msg.type = MessageType::REVERSEYTYPE;
+      msg.reversed = config.reverseY;
+    break;
+    case CONFIG_FLIP_XY:
+      msg.type = MessageType::FLIPXYTYPE;
+      msg.flipXY = config.flipXY;
+    break;
+    case CONFIG_REPORTED_TOUCHES:
+      msg.type = MessageType::REPORTEDTOUCHESTYPE;
+      msg.reportedTouches = config.reportedTouches;
+    break;
+    default:
+      msg.type = MessageType::DEVICECONFIGURATIONTYPE;
+      msg.configuration = config;
+    break;
+  }
+
+  return true;
+}
+
+static const ContentDecoderEntry decoders[] =
+{
+  { 0xF0, 0xA0, DecodeTouch },
+  { 0xF0, 0x63, DecodeBootComplete },
+  { 0xEF, 0x65, DecodeEnable },
+  { 0xEF, 0x73, DecodeDeviceConfiguration },
+};
+
+ZforceBase::ZforceBase() : readMode(ReadMode::HEADER_FIRST), expectedLength(ZFORCE_INITIAL_READ_LENGTH), readPending(false), readStatus(0)
+{
+  memset(&readStats, 0, sizeof(readStats));
+}
+
+void ZforceBase::SetReadMode(ReadMode mode)
+{
+  readMode = mode;
+}
+
+const ReadStats& ZforceBase::GetReadStats() const
+{
+  return readStats;
+}
+
+void ZforceBase::ResetReadStats()
+{
+  memset(&readStats, 0, sizeof(readStats));
 }
 
-bool Zforce::ReverseY(bool isReversed)
+/*
+ * Sends a request frame. The response is identified by its content when it is read.
+ */
+bool ZforceBase::Send(const uint8_t* frame)
 {
-  bool failed = false;
+  return Write(frame) == 0; // We assume that the end user has called GetMessage prior to calling this method
+}
 
-  uint8_t reverseY[] = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x85, 0x01, (uint8_t)(isReversed ? 0xFF : 0x00)};
+bool ZforceBase::Enable(bool isEnabled)
+{
+  return Send(isEnabled ? EnableRequest<true>::Frame() : EnableRequest<false>::Frame());
+}
 
-  if (Write(reverseY)) // We assume that the end user has called GetMessage prior to calling this method
+bool ZforceBase::TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY)
+{
+  const uint16_t values[] = {minX, minY, maxX, maxY};
+  uint8_t touchActiveArea[TouchActiveAreaRequest::size];
+  TouchActiveAreaRequest::Encode(touchActiveArea, values);
+
+  return Send(touchActiveArea);
+}
+
+bool ZforceBase::FlipXY(bool isFlipped)
+{
+  return Send(isFlipped ? FlipXYRequest<true>::Frame() : FlipXYRequest<false>::Frame());
+}
+
+bool ZforceBase::ReverseX(bool isReversed)
+{
+  return Send(isReversed ? ReverseXRequest<true>::Frame() : ReverseXRequest<false>::Frame());
+}
+
+bool ZforceBase::ReverseY(bool isReversed)
+{
+  return Send(isReversed ? ReverseYRequest<true>::Frame() : ReverseYRequest<false>::Frame());
+}
+
+bool ZforceBase::ReportedTouches(uint8_t touches)
+{
+  if(touches > MAX_REPORTED_TOUCHES)
   {
-    failed = true;
+    touches = MAX_REPORTED_TOUCHES;
   }
-  else
+
+  const uint16_t values[] = {touches};
+  uint8_t reportedTouches[ReportedTouchesRequest::size];
+  ReportedTouchesRequest::Encode(reportedTouches, values);
+
+  return Send(reportedTouches);
+}
+
+/*
+ * Bytes of the device configuration request holding the settings in fields,
+ * headers included.
+ */
+uint8_t ZforceBase::ConfigurationLength(uint8_t fields)
+{
+  uint8_t length = 2 + 2 + 4 + 2; // I2C header, frame, address and 0x73
+  if (fields & (CONFIG_TOUCH_ACTIVE_AREA | CONFIG_REVERSE_X | CONFIG_REVERSE_Y | CONFIG_FLIP_XY))
   {
-    lastSentMessage = MessageType::REVERSEYTYPE;
+    length += 2;
+    length += (fields & CONFIG_TOUCH_ACTIVE_AREA) ? 4 * 4 : 0;
+    length += (fields & CONFIG_REVERSE_X) ? 3 : 0;
+    length += (fields & CONFIG_REVERSE_Y) ? 3 : 0;
+    length += (fields & CONFIG_FLIP_XY) ? 3 : 0;
   }
-
-  return !failed;
+  length += (fields & CONFIG_REPORTED_TOUCHES) ? 3 : 0;
+  return length;
 }
 
-bool Zforce::ReportedTouches(uint8_t touches)
+/*
+ * Sends all settings flagged in config as a single device configuration request,
+ * so a full reconfiguration costs one round trip. The response is decoded into a
+ * DEVICECONFIGURATIONTYPE message holding the settings the sensor reported back,
+ * or the message type of the single setting if only one was reported.
+ * Returns false without writing if the request is longer than MaxWrite(), which
+ * with a 32 byte Wire buffer is the case for every setting at once;
+ * CommandQueue splits such a configuration in two requests.
+ */
+bool ZforceBase::Configure(const DeviceConfiguration& config)
 {
-  bool failed = false;
+  uint8_t frame[MAX_CONFIGURATION_REQUEST];
+  BerWriter writer(frame, sizeof(frame));
+  static const uint8_t address[] = {0x40, 0x02, 0x02, 0x00};
 
-  if(touches > 10)
+  if ((config.fields & CONFIG_ALL) == 0 || ConfigurationLength(config.fields) > MaxWrite())
   {
-    touches = 10;
+    return false;
   }
 
-  uint8_t reportedTouches[] = {0xEE, 0x0B, 0xEE, 0x09, 0x40, 0x02, 0x02, 0x00, 0x73, 0x03, 0x86, 0x01, touches};
-
-  if (Write(reportedTouches)) // We assume that the end user has called GetMessage prior to calling this method
+  writer.Begin(0xEE); // I2C header
+  writer.Begin(0xEE);
+  writer.Bytes(address, sizeof(address));
+  writer.Begin(0x73);
+  if (config.fields & (CONFIG_TOUCH_ACTIVE_AREA | CONFIG_REVERSE_X | CONFIG_REVERSE_Y | CONFIG_FLIP_XY))
+  {
+    writer.Begin(0xA2);
+    if (config.fields & CONFIG_TOUCH_ACTIVE_AREA)
+    {
+      writer.Uint16(0x80, config.touchActiveArea.minX);
+      writer.Uint16(0x81, config.touchActiveArea.minY);
+      writer.Uint16(0x82, config.touchActiveArea.maxX);
+      writer.Uint16(0x83, config.touchActiveArea.maxY);
+    }
+    if (config.fields & CONFIG_REVERSE_X)
+    {
+      writer.Boolean(0x84, config.reverseX);
+    }
+    if (config.fields & CONFIG_REVERSE_Y)
+    {
+      writer.Boolean(0x85, config.reverseY);
+    }
+    if (config.fields & CONFIG_FLIP_XY)
+    {
+      writer.Boolean(0x86, config.flipXY);
+    }
+    writer.End();
+  }
+  if (config.fields & CONFIG_REPORTED_TOUCHES)
   {
-    failed = true;
+    writer.Uint8(0x86, config.reportedTouches > MAX_REPORTED_TOUCHES ? MAX_REPORTED_TOUCHES : config.reportedTouches);
   }
-  else
+  writer.End();
+  writer.End();
+  writer.End();
+
+  if (writer.IsOverflowed())
   {
-    lastSentMessage = MessageType::REPORTEDTOUCHESTYPE;
+    return false;
   }
 
-  return !failed;
+  return Send(frame);
 }
 
-
-int Zforce::GetDataReady()
+int ZforceBase::GetDataReady()
 {
   return digitalRead(dataReady);
 }
 
-Message* Zforce::GetMessage()
+Message* ZforceBase::GetMessage()
 {
   Message* msg = nullptr;
   if(GetDataReady() == HIGH)
@@ -237,262 +431,142 @@ Message* Zforce::GetMessage()
   return msg;
 }
 
-void Zforce::DestroyMessage(Message* msg)
+void ZforceBase::DestroyMessage(Message* msg)
 {
   delete msg;
   msg = nullptr;
 }
 
-Message* Zforce::VirtualParse(uint8_t* payload)
+Message* ZforceBase::VirtualParse(uint8_t* payload)
 {
-  Message* msg = nullptr;
+  MessageVariant decoded;
+  if(!Parse(payload, decoded))
+  {
+    return nullptr;
+  }
+
+  return CreateMessage(decoded);
+}
 
-  switch(payload[2]) // Check if the payload is a response to a request or if it's a notification.
+bool ZforceBase::Parse(uint8_t* payload, MessageVariant& msg)
+{
+  bool decoded = false;
+  BerTlv frame;
+  BerTlv address;
+  BerTlv content;
+  msg.type = MessageType::NONE;
+
+  // payload[0] is the I2C frame type and payload[1] the length of the BER encoded frame that follows.
+  if (payload[1] > MAX_PAYLOAD - 2)
   {
-    case 0xEF:
-    {
-      ParseResponse(payload, &msg);
-    }
-    break;
-    case 0xF0:
+    return false; // Only the part that fit was read; the reader would run past the buffer.
+  }
+  BerReader reader(&payload[2], payload[1]);
+  if (reader.Next(frame))
+  {
+    BerReader body(frame);
+    if (body.Next(address) && address.tag == 0x40 && body.Next(content))
     {
-      if (payload[8] == 0xA0) // Check the identifier if this is a touch message or something else.
-      {
-        msg = new TouchMessage;
-        msg->type = MessageType::TOUCHTYPE;
-        ParseTouch((TouchMessage*)msg, payload);
-      }
-      else if (payload[8] == 0x63)
+      decoded = frame.tag == 0xEF; // A response to a request; NONE unless the content is known.
+
+      for (uint8_t i = 0; i < sizeof(decoders) / sizeof(decoders[0]); i++)
       {
-        msg = new Message;
-        msg->type = MessageType::BOOTCOMPLETETYPE;
+        if (decoders[i].frameTag == frame.tag && decoders[i].contentTag == content.tag)
+        {
+          decoded = decoders[i].decode(msg, content);
+          break;
+        }
       }
     }
-    break;
-
-    default:
-    break;
   }
 
-  lastSentMessage = MessageType::NONE;
-  return msg;
+  return decoded;
 }
 
-void Zforce::ParseResponse(uint8_t* payload, Message** msg)
+/*
+ * Copies a decoded message into a heap allocated message for the pointer based API.
+ */
+Message* ZforceBase::CreateMessage(const MessageVariant& decoded)
 {
-  switch(lastSentMessage)
+  Message* msg = nullptr;
+
+  switch(decoded.type)
   {
-    case MessageType::REVERSEYTYPE:
-    {
-      (*(msg)) = new ReverseYMessage;
-      (*(msg))->type = MessageType::REVERSEYTYPE;
-      ParseReverseY((ReverseYMessage*)(*(msg)), payload);
-    }
-    break;
     case MessageType::ENABLETYPE:
     {
-      (*(msg)) = new EnableMessage;
-      (*(msg))->type = MessageType::ENABLETYPE;
-      ParseEnable((EnableMessage*)(*(msg)), payload);
+      EnableMessage* enable = new EnableMessage;
+      enable->enabled = decoded.enabled;
+      msg = enable;
     }
     break;
     case MessageType::TOUCHACTIVEAREATYPE:
     {
-      (*(msg)) = new TouchActiveAreaMessage;
-      (*(msg))->type = MessageType::TOUCHACTIVEAREATYPE;
-      ParseTouchActiveArea((TouchActiveAreaMessage*)(*(msg)), payload);
+      TouchActiveAreaMessage* area = new TouchActiveAreaMessage;
+      area->minX = decoded.touchActiveArea.minX;
+      area->minY = decoded.touchActiveArea.minY;
+      area->maxX = decoded.touchActiveArea.maxX;
+      area->maxY = decoded.touchActiveArea.maxY;
+      msg = area;
     }
     break;
     case MessageType::REVERSEXTYPE:
     {
-      (*(msg)) = new ReverseXMessage;
-      (*(msg))->type = MessageType::REVERSEXTYPE;
-      ParseReverseX((ReverseXMessage*)(*(msg)), payload);
+      ReverseXMessage* reverseX = new ReverseXMessage;
+      reverseX->reversed = decoded.reversed;
+      msg = reverseX;
+    }
+    break;
+    case MessageType::REVERSEYTYPE:
+    {
+      ReverseYMessage* reverseY = new ReverseYMessage;
+      reverseY->reversed = decoded.reversed;
+      msg = reverseY;
     }
     break;
     case MessageType::FLIPXYTYPE:
     {
-      (*(msg)) = new FlipXYMessage;
-      (*(msg))->type = MessageType::FLIPXYTYPE;
-      ParseFlipXY((FlipXYMessage*)(*(msg)), payload);
+      FlipXYMessage* flipXY = new FlipXYMessage;
+      flipXY->flipXY = decoded.flipXY;
+      msg = flipXY;
     }
     break;
     case MessageType::REPORTEDTOUCHESTYPE:
     {
-      (*(msg)) = new ReportedTouchesMessage;
-      (*(msg))->type = MessageType::REPORTEDTOUCHESTYPE;
-      ParseReportedTouches((ReportedTouchesMessage*)(*(msg)), payload);
+      ReportedTouchesMessage* reportedTouches = new ReportedTouchesMessage;
+      reportedTouches->reportedTouches = decoded.reportedTouches;
+      msg = reportedTouches;
     }
     break;
-    default:
+    case MessageType::DEVICECONFIGURATIONTYPE:
     {
-      (*(msg)) = new Message;
-      (*(msg))->type = MessageType::NONE;
+      DeviceConfigurationMessage* configuration = new DeviceConfigurationMessage;
+      configuration->configuration = decoded.configuration;
+      msg = configuration;
     }
     break;
-  }
-}
-
-void Zforce::ParseTouchActiveArea(TouchActiveAreaMessage* msg, uint8_t* payload)
-{
-  const uint8_t offset = 10;
-  uint16_t value = 0;
-  uint16_t valueLength = 0;
-  for (int i = offset; i < payload[11] + offset; i++) // 10 = index for SubTouchActiveArea struct, 11 index for length of SubTouchActiveArea struct
-  {
-    switch (payload[i])
+    case MessageType::TOUCHTYPE:
     {
-      case 0x80: // MinX
-        valueLength = payload[i + 1];
-        if (valueLength == 2)
-        {
-          value = payload[i + 2] << 8;
-          value |= payload[i + 3];
-        }
-        else
-        {
-          value = payload[i + 2];
-        }
-        msg->minX = value;
-      break;
-
-      case 0x81: // MinY
-        valueLength = payload[i + 1];
-        if (valueLength == 2)
-        {
-          value = payload[i + 2] << 8;
-          value |= payload[i + 3];
-        }
-        else
-        {
-          value = payload[i + 2];
-        }
-        msg->minY = value;
-      break;
-
-      case 0x82: // MaxX
-        valueLength = payload[i + 1];
-        if (valueLength == 2)
-        {
-          value = payload[i + 2] << 8;
-          value |= payload[i + 3];
-        }
-        else
-        {
-          value = payload[i + 2];
-        }
-        msg->maxX = value;
-      break;
-
-      case 0x83: // MaxY
-        valueLength = payload[i + 1];
-        if (valueLength == 2)
-        {
-          value = payload[i + 2] << 8;
-          value |= payload[i + 3];
-        }
-        else
-        {
-          value = payload[i + 2];
-        }
-        msg->maxY = value;
-      break;
-
-      default:
-      break;
+      TouchMessage* touch = new TouchMessage;
+      touch->touchCount = decoded.touch.touchCount;
+      touch->touchData = new TouchData[touch->touchCount];
+      memcpy(touch->touchData, decoded.touch.touchData, touch->touchCount * sizeof(TouchData));
+      msg = touch;
     }
-  }
-}
-
-void Zforce::ParseEnable(EnableMessage* msg, uint8_t* payload)
-{
-  switch (payload[10])
-  {
-    case 0x80:
-      msg->enabled = false;
     break;
-
-    case 0x81:
-      msg->enabled = true;
-    break;
-
     default:
-    break;
-  }
-}
-
-void Zforce::ParseReportedTouches(ReportedTouchesMessage* msg, uint8_t* payload)
-{
-  const uint8_t offset = 10;
-  for(int i = offset + payload[11]; i < payload[9] + offset; i++)
-  {
-    if(payload[i] == 0x86)
     {
-      msg->reportedTouches = payload[i + 2];
-      break;
+      msg = new Message;
     }
-  }
-}
-
-void Zforce::ParseReverseX(ReverseXMessage* msg, uint8_t* payload)
-{
-  const uint8_t offset = 10;
-  for(int i = offset; i < payload[11] + offset; i++)
-  {
-    if(payload[i] == 0x84)
-    {
-      msg->reversed = (bool)payload[i + 2];
-      break;
-    }
-  }
-}
-
-void Zforce::ParseReverseY(ReverseYMessage* msg, uint8_t* payload)
-{
-  const uint8_t offset = 10;
-  for(int i = offset; i < payload[11] + offset; i++)
-  {
-    if(payload[i] == 0x85)
-    {
-      msg->reversed = (bool)payload[i + 2];
-      break;
-    }
-  }
-}
-
-void Zforce::ParseFlipXY(FlipXYMessage* msg, uint8_t* payload)
-{
-  const uint8_t offset = 10;
-  for(int i = offset; i < payload[11] + offset; i++)
-  {
-    if(payload[i] == 0x86)
-    {
-      msg->flipXY = (bool)payload[i + 2];
-      break;
-    }
-  }
-}
-
-void Zforce::ParseTouch(TouchMessage* msg, uint8_t* payload)
-{
-  msg->touchCount = payload[9] / 11; // Calculate the amount of touch objects.
-  msg->touchData = new TouchData[msg->touchCount];
-
-  for(uint8_t i = 0; i < msg->touchCount; i++)
-  {
-    msg->touchData[i].id = payload[12 + (i * 11)];
-    msg->touchData[i].event = (TouchEvent)(payload[13 + (i * 11)]);
-    msg->touchData[i].x = payload[14 + (i * 11)] << 8;
-    msg->touchData[i].x |= payload[15 + (i * 11)];
-    msg->touchData[i].y = payload[16 + (i * 11)] << 8;
-    msg->touchData[i].y |= payload[17 + (i * 11)];
+    break;
   }
 
+  msg->type = decoded.type;
+  return msg;
 }
 
-void Zforce::ClearBuffer(uint8_t* buffer)
+void ZforceBase::ClearBuffer(uint8_t* buffer)
 {
   memset(buffer, 0, MAX_PAYLOAD);
 }
 
-Zforce zforce = Zforce();
+Zforce<> zforce;
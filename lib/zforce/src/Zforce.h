@@ -18,9 +18,34 @@
 */
 #pragma once
 
+#include <inttypes.h>
+#include <string.h>
+#if(ARDUINO >= 100)
+  #include <Arduino.h>
+#else
+  #include <WProgram.h>
+#endif
+#if !ZFORCE_SERCOM_DMA
+  #include "I2C/I2C.h" // Only for USE_I2C_LIB off AVR, which selects the default transport below.
+#endif
+
 #define MAX_PAYLOAD 127
+#define MAX_REPORTED_TOUCHES 10
 #define ZFORCE_I2C_ADDRESS 0x50
 
+// Read errors of the library itself, distinct from the I2C status codes.
+#define ZFORCE_READ_OVERFLOW -1  // The frame is longer than MAX_PAYLOAD.
+#define ZFORCE_READ_TRUNCATED -2 // The bus returned fewer bytes than the frame header announced.
+#define ZFORCE_WRITE_OVERFLOW -3 // The request is longer than the Wire buffer.
+
+#define ZFORCE_INITIAL_READ_LENGTH 21 // A touch notification with one touch, header included.
+
+#ifdef F_CPU
+  #define ZFORCE_CPU_MHZ (F_CPU / 1000000L)
+#else
+  #define ZFORCE_CPU_MHZ 48 // the neonode prototype board
+#endif
+
 enum TouchEvent
 {
 	DOWN = 0,
@@ -40,9 +65,38 @@ enum class MessageType
 	FLIPXYTYPE = 5,
 	REPORTEDTOUCHESTYPE = 6,
 	TOUCHTYPE = 7,
-	BOOTCOMPLETETYPE = 8
+	BOOTCOMPLETETYPE = 8,
+	DEVICECONFIGURATIONTYPE = 9
 };
 
+// Settings held by a DeviceConfiguration, combined in DeviceConfiguration::fields.
+enum ConfigurationField
+{
+	CONFIG_TOUCH_ACTIVE_AREA = 0x01,
+	CONFIG_REVERSE_X = 0x02,
+	CONFIG_REVERSE_Y = 0x04,
+	CONFIG_FLIP_XY = 0x08,
+	CONFIG_REPORTED_TOUCHES = 0x10,
+	CONFIG_ALL = 0x1F
+};
+
+
+enum class ReadMode
+{
+	HEADER_FIRST = 0,      // Header and frame in two transactions.
+	SINGLE_TRANSACTION = 1 // One transaction of the expected length, a second one only if the frame is longer.
+};
+
+typedef struct ReadStats
+{
+	unsigned long frames;
+	unsigned long transactions;
+	unsigned long bytes;         // Clocked bytes, including padding read past the end of a frame.
+	unsigned long continuations; // Single transaction reads that needed a second transaction.
+	unsigned long busTime;       // us spent in Read() over all frames.
+	unsigned long lastBusTime;
+	unsigned long cpuCycles;     // CPU cycles spent reading; the whole bus time unless the DMA transport is used.
+} ReadStats;
 
 typedef struct TouchData
 {
@@ -129,37 +183,434 @@ typedef struct ReportedTouchesMessage : public Message
 	uint8_t reportedTouches;
 } ReportedTouchesMessage;
 
+typedef struct TouchActiveAreaData
+{
+	uint16_t minX;
+	uint16_t minY;
+	uint16_t maxX;
+	uint16_t maxY;
+} TouchActiveAreaData;
+
+/*
+ * Any subset of the device configuration settings, sent as one request by
+ * ZforceBase::Configure() and decoded from its response. Only the settings flagged
+ * in fields are valid.
+ */
+typedef struct DeviceConfiguration
+{
+	uint8_t fields;
+	TouchActiveAreaData touchActiveArea;
+	bool reverseX;
+	bool reverseY;
+	bool flipXY;
+	uint8_t reportedTouches;
+} DeviceConfiguration;
 
-class Zforce 
+typedef struct DeviceConfigurationMessage : public Message
+{
+	virtual ~DeviceConfigurationMessage()
+	{
+
+	}
+	DeviceConfiguration configuration;
+} DeviceConfigurationMessage;
+
+typedef struct TouchFrame
+{
+	uint8_t touchCount;
+	TouchData touchData[MAX_REPORTED_TOUCHES];
+} TouchFrame;
+
+/*
+ * Tagged union holding any message, decoded into storage owned by the caller.
+ * Only the member matching type is valid; REVERSEXTYPE and REVERSEYTYPE both
+ * use reversed.
+ */
+typedef struct MessageVariant
+{
+	MessageType type;
+	union
+	{
+		bool enabled;
+		TouchActiveAreaData touchActiveArea;
+		bool flipXY;
+		bool reversed;
+		uint8_t reportedTouches;
+		TouchFrame touch;
+		DeviceConfiguration configuration;
+	};
+} MessageVariant;
+
+
+class WireTransport;
+class I2cTransport;
+class SercomDmaTransport;
+
+// Bus used by the global zforce and by Zforce<> without arguments.
+#ifndef ZFORCE_DEFAULT_TRANSPORT
+  #if ZFORCE_SERCOM_DMA
+    #define ZFORCE_DEFAULT_TRANSPORT SercomDmaTransport
+  #elif USE_I2C_LIB == 1
+    #define ZFORCE_DEFAULT_TRANSPORT I2cTransport
+  #else
+    #define ZFORCE_DEFAULT_TRANSPORT WireTransport
+  #endif
+#endif
+
+/*
+ * The part of the sensor interface that does not depend on the bus: requests,
+ * decoding and statistics. Code that works with any sensor, like CommandQueue,
+ * takes a ZforceBase&; the bus itself is only reached through the virtual
+ * methods, which Zforce<Transport> overrides.
+ */
+class ZforceBase
 {
     public:
-		Zforce();
-		void Start(int dr);
-		int Read(uint8_t* payload);
-		int Write(uint8_t* payload);
+		virtual void Start(int dr) = 0;
+		virtual int Read(uint8_t* payload) = 0;
+		virtual int Write(const uint8_t* payload) = 0;
+		virtual bool Probe() = 0;
+		virtual uint8_t GetAddress() const = 0;
+		virtual uint8_t MaxWrite() const = 0; // longest request Write() takes
 		bool Enable(bool isEnabled);
 		bool TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY);
 		bool FlipXY(bool isFlipped);
 		bool ReverseX(bool isReversed);
 		bool ReverseY(bool isReversed);
 		bool ReportedTouches(uint8_t touches); // Missing
+		bool Configure(const DeviceConfiguration& config);
+		static uint8_t ConfigurationLength(uint8_t fields);
 		int GetDataReady();
 		Message* GetMessage();
+		virtual bool GetMessage(MessageVariant& msg) = 0;
 		void DestroyMessage(Message * msg);
-    private:
+		void SetReadMode(ReadMode mode);
+		const ReadStats& GetReadStats() const;
+		void ResetReadStats();
+    protected:
+		ZforceBase();
+		~ZforceBase() {}
+		bool Send(const uint8_t* frame);
 		Message* VirtualParse(uint8_t* payload);
-		void ParseTouchActiveArea(TouchActiveAreaMessage* msg, uint8_t* payload);
-		void ParseEnable(EnableMessage* msg, uint8_t* payload);
-		void ParseReportedTouches(ReportedTouchesMessage* msg, uint8_t* payload);
-		void ParseReverseX(ReverseXMessage* msg, uint8_t* payload);
-		void ParseReverseY(ReverseYMessage* msg, uint8_t* payload);
-		void ParseFlipXY(FlipXYMessage* msg, uint8_t* payload);
-		void ParseTouch(TouchMessage* msg, uint8_t* payload);
-		void ParseResponse(uint8_t* payload, Message** msg);
+		bool Parse(uint8_t* payload, MessageVariant& msg);
+		Message* CreateMessage(const MessageVariant& msg);
 		void ClearBuffer(uint8_t* buffer);
 		uint8_t buffer[MAX_PAYLOAD];
 		int dataReady;
-		volatile MessageType lastSentMessage;
+		ReadMode readMode;
+		uint8_t expectedLength;
+		ReadStats readStats;
+		bool readPending;
+		int readStatus;
 };
 
-extern Zforce zforce;
\ No newline at end of file
+/*
+ * A sensor on the bus given by Transport, one of WireTransport, I2cTransport
+ * or SercomDmaTransport. The transport is a member and its calls are resolved
+ * at compile time, so they inline into the read path; only the transports
+ * that are named get compiled in. A transport provides
+ *
+ *   void Begin(int dataReady, uint8_t* buffer, uint8_t size);
+ *   int Read(uint8_t* data, uint8_t count, ReadStats& stats);  // one bus read, 0 if success
+ *   int Write(const uint8_t* data, uint8_t length);
+ *   static const uint8_t maxWrite;     // longest request Write() takes in one transaction
+ *   bool Probe();                      // true if the address is acknowledged
+ *   uint8_t Address() const;
+ *
+ * and for frame reads in the background, used by BeginRead() and EndRead(),
+ *
+ *   static const bool readsFrames;     // BeginFrame() reads a whole frame into the Begin() buffer
+ *   static const bool armsOnDataReady; // BeginFrame() waits for data ready by itself
+ *   int BeginFrame();                  // 0 if the read was started
+ *   bool FramePending();
+ *   int EndFrame(uint8_t* payload, ReadStats& stats);
+ *   bool CancelFrame();                // false if a frame was already read
+ */
+template <typename Transport = ZFORCE_DEFAULT_TRANSPORT>
+class Zforce final : public ZforceBase
+{
+    public:
+		Zforce(const Transport& transport = Transport()) : transport(transport) {}
+		void Start(int dr) override;
+		int Read(uint8_t* payload) override;
+		int Write(const uint8_t* payload) override;
+		bool Probe() override;
+		uint8_t GetAddress() const override;
+		uint8_t MaxWrite() const override;
+		using ZforceBase::GetMessage;
+		bool GetMessage(MessageVariant& msg) override;
+		bool BeginRead();
+		bool EndRead(MessageVariant& msg);
+		bool IsReading() const;
+		Transport& GetTransport();
+    private:
+		int ReadHeaderFirst(uint8_t* payload);
+		int ReadSingleTransaction(uint8_t* payload);
+		int ReadExcess(uint8_t* payload);
+		int ReadTransaction(uint8_t* data, uint8_t count);
+		Transport transport;
+};
+
+template <typename Transport>
+void Zforce<Transport>::Start(int dr)
+{
+	dataReady = dr;
+	pinMode(dataReady, INPUT);
+	transport.Begin(dataReady, buffer, MAX_PAYLOAD);
+}
+
+/*
+ * Reads one frame into payload, which must hold MAX_PAYLOAD bytes. A frame that
+ * does not fit is read to the end so the sensor moves on, but only the part that
+ * fits is stored and ZFORCE_READ_OVERFLOW is returned.
+ */
+template <typename Transport>
+int Zforce<Transport>::Read(uint8_t* payload)
+{
+	if (Transport::armsOnDataReady)
+	{
+		bool ready = !transport.CancelFrame();
+		readPending = false;
+		if (ready)
+		{
+			// A frame read from data ready is waiting in the buffer.
+			return transport.EndFrame(payload, readStats);
+		}
+	}
+	unsigned long start = micros();
+	int status = 0;
+
+	if (readMode == ReadMode::SINGLE_TRANSACTION)
+	{
+		status = ReadSingleTransaction(payload);
+	}
+	else
+	{
+		status = ReadHeaderFirst(payload);
+	}
+
+	unsigned long busTime = micros() - start;
+	readStats.frames++;
+	readStats.busTime += busTime;
+	readStats.lastBusTime = busTime;
+	readStats.cpuCycles += busTime * ZFORCE_CPU_MHZ; // The bus is polled for the whole read.
+
+	return status; // return 0 if success, otherwise error code according to Atmel Data Sheet
+}
+
+/*
+ * Reads the 2 byte I2C header, then exactly the frame it announces.
+ */
+template <typename Transport>
+int Zforce<Transport>::ReadHeaderFirst(uint8_t* payload)
+{
+	int status = ReadTransaction(payload, 2);
+	if (status)
+	{
+		return status;
+	}
+
+	uint8_t length = payload[1] > MAX_PAYLOAD - 2 ? MAX_PAYLOAD - 2 : payload[1];
+	if (length > 0)
+	{
+		status = ReadTransaction(&payload[2], length);
+	}
+
+	return status ? status : ReadExcess(payload);
+}
+
+/*
+ * Reads header and frame in one transaction of the length of the previous frame,
+ * which is what the sensor sends most of the time when touches stream. A longer
+ * frame is completed by a continuation read; the bytes past the end of a shorter
+ * frame are padding from the sensor and are ignored.
+ */
+template <typename Transport>
+int Zforce<Transport>::ReadSingleTransaction(uint8_t* payload)
+{
+	uint8_t expected = expectedLength;
+	int status = ReadTransaction(payload, expected);
+	if (status)
+	{
+		return status;
+	}
+
+	uint8_t length = payload[1] > MAX_PAYLOAD - 2 ? MAX_PAYLOAD : payload[1] + 2;
+	if (length > expected)
+	{
+		readStats.continuations++;
+		status = ReadTransaction(&payload[expected], length - expected);
+	}
+	expectedLength = length < 2 ? 2 : length;
+
+	return status ? status : ReadExcess(payload);
+}
+
+/*
+ * Reads and drops the rest of a frame longer than MAX_PAYLOAD.
+ */
+template <typename Transport>
+int Zforce<Transport>::ReadExcess(uint8_t* payload)
+{
+	int status = 0;
+	uint8_t scratch[16];
+	uint8_t excess = payload[1] > MAX_PAYLOAD - 2 ? payload[1] - (MAX_PAYLOAD - 2) : 0;
+
+	while (!status && excess > 0)
+	{
+		uint8_t chunk = excess > sizeof(scratch) ? sizeof(scratch) : excess;
+		status = ReadTransaction(scratch, chunk);
+		excess -= chunk;
+	}
+
+	if (!status && payload[1] > MAX_PAYLOAD - 2)
+	{
+		status = ZFORCE_READ_OVERFLOW;
+	}
+
+	return status;
+}
+
+template <typename Transport>
+inline int Zforce<Transport>::ReadTransaction(uint8_t* data, uint8_t count)
+{
+	return transport.Read(data, count, readStats);
+}
+
+/*
+ * Sends a message in the form of a byte array.
+ */
+template <typename Transport>
+int Zforce<Transport>::Write(const uint8_t* payload)
+{
+	return transport.Write(payload, payload[1] + 2); // 0 if success, otherwise the error code of the bus
+}
+
+/*
+ * Reads and decodes a message into caller owned storage without using the heap.
+ * Returns false if data ready is LOW or no message could be decoded.
+ */
+template <typename Transport>
+bool Zforce<Transport>::GetMessage(MessageVariant& msg)
+{
+	if (Transport::armsOnDataReady)
+	{
+		// Frames are read from the data ready edge, see BeginRead(). The read is
+		// armed again once the buffer has been parsed, so no edge is missed.
+		if (!readPending)
+		{
+			BeginRead();
+		}
+		bool decoded = EndRead(msg);
+		if (!readPending)
+		{
+			BeginRead();
+		}
+		return decoded;
+	}
+
+	bool decoded = false;
+	if(GetDataReady() == HIGH)
+	{
+		if(!Read(buffer))
+		{
+			decoded = Parse(buffer, msg); // Parse never looks past the frame length, no need to clear the buffer.
+		}
+	}
+
+	return decoded;
+}
+
+/*
+ * Split version of GetMessage(MessageVariant&). BeginRead() starts reading a
+ * frame if data ready is HIGH and returns true if a read was started; EndRead()
+ * returns false while the read is still running, and otherwise decodes the
+ * frame like GetMessage(). With the I2C library the frame is clocked in from
+ * the TWI interrupt, leaving the CPU free between the two calls. With the
+ * SERCOM DMA transport BeginRead() arms the read, which the DMAC then carries
+ * out from the data ready edge; it returns true even while data ready is LOW.
+ * Wire has no interrupt driven reads, there BeginRead() reads the whole frame.
+ */
+template <typename Transport>
+bool Zforce<Transport>::BeginRead()
+{
+	if (readPending)
+	{
+		return false;
+	}
+	if (Transport::armsOnDataReady)
+	{
+		readPending = transport.BeginFrame() == 0;
+		return readPending;
+	}
+	if (GetDataReady() != HIGH)
+	{
+		return false;
+	}
+	readStatus = Transport::readsFrames ? transport.BeginFrame() : Read(buffer);
+	readPending = readStatus == 0;
+	return readPending;
+}
+
+template <typename Transport>
+bool Zforce<Transport>::EndRead(MessageVariant& msg)
+{
+	if (!readPending)
+	{
+		return false;
+	}
+	if (Transport::readsFrames || Transport::armsOnDataReady)
+	{
+		if (transport.FramePending())
+		{
+			return false;
+		}
+		readStatus = transport.EndFrame(buffer, readStats);
+	}
+	readPending = false;
+	return !readStatus && Parse(buffer, msg);
+}
+
+/*
+ * Checks that a device acknowledges the address of the sensor, for discovery
+ * at startup. Must not be called while a read is in progress.
+ */
+template <typename Transport>
+bool Zforce<Transport>::Probe()
+{
+	return transport.Probe();
+}
+
+template <typename Transport>
+uint8_t Zforce<Transport>::GetAddress() const
+{
+	return transport.Address();
+}
+
+template <typename Transport>
+uint8_t Zforce<Transport>::MaxWrite() const
+{
+	return Transport::maxWrite;
+}
+
+template <typename Transport>
+bool Zforce<Transport>::IsReading() const
+{
+	return readPending;
+}
+
+template <typename Transport>
+Transport& Zforce<Transport>::GetTransport()
+{
+	return transport;
+}
+
+#if ZFORCE_SERCOM_DMA
+  #include "SercomDma/SercomDmaTransport.h"
+#elif USE_I2C_LIB == 1
+  #include "I2C/I2cTransport.h"
+#else
+  #include "WireTransport.h"
+#endif
+
+extern Zforce<> zforce;
@@ -14,15 +14,23 @@ void loop()
     auto result = SensorHelper::updateTouch();
     if (result > 0)
     {
-        SensorHelper::printTouchMessage();
-
-        if (SensorHelper::readReg(SensorHelper::reg_R_Touch + 3) == 2)
+        bool up = SensorHelper::readReg(SensorHelper::reg_R_ChangedSlots) & ~SensorHelper::readReg(SensorHelper::reg_R_ActiveSlots);
+        if (SensorHelper::getSerialProtocol() == SensorHelper::SerialProtocol::BINARY)
         {
-            SensorHelper::printRegs();
+            SensorHelper::queueTouchFrame();
+            if (up)
+            {
+                SensorHelper::queueRegs();
+            }
+        }
+        else
+        {
+            SensorHelper::printTouchMessage();
+            if (up)
+            {
+                SensorHelper::printRegs();
+            }
         }
     }
-    if(Serial.available())
-    {
-        SensorHelper::decode(Serial.readString());
-    }
+    SensorHelper::pollSerial();
 }
\ No newline at end of file
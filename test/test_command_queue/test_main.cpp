@@ -0,0 +1,135 @@
+/*  Commands against the simulated sensor
+
+    A device configuration with every setting is longer than the 32 byte
+    Wire buffer of the AVR core; CommandQueue has to split it and still
+    complete it with one merged response. Run in native_wire32 to split.
+    A single setting may come back inside the whole device configuration.
+*/
+#include <Arduino.h>
+#include <HostArduino.h>
+#include <SimZforce.h>
+#include <unity.h>
+#include "CommandQueue.h"
+
+static CommandQueue queue(zforce);
+static CommandStatus lastStatus;
+static MessageVariant lastResponse;
+
+void setUp() { lastStatus = CommandStatus::UNKNOWN; }
+void tearDown() {}
+
+static void done(uint16_t handle, CommandStatus status, const MessageVariant *response, void *context)
+{
+    lastStatus = status;
+    if (response != nullptr)
+        lastResponse = *response;
+}
+
+static void runQueue(unsigned long timeout = 100)
+{
+    MessageVariant msg;
+    unsigned long start = millis();
+    while (!queue.IsIdle() && millis() - start < timeout)
+    {
+        queue.Poll(msg);
+        delay(1);
+    }
+}
+
+static CommandRequest fullConfiguration()
+{
+    CommandRequest request;
+    memset(&request, 0, sizeof(request));
+    request.type = MessageType::DEVICECONFIGURATIONTYPE;
+    request.configuration.fields = CONFIG_ALL;
+    request.configuration.touchActiveArea = {100, 200, 3000, 4000};
+    request.configuration.reverseX = true;
+    request.configuration.reverseY = false;
+    request.configuration.flipXY = true;
+    request.configuration.reportedTouches = 5;
+    return request;
+}
+
+void test_start()
+{
+    MessageVariant msg;
+    zforce.Start(PIN_NN_DR);
+    unsigned long start = millis();
+    bool booted = false;
+    while (!booted && millis() - start < 100)
+    {
+        booted = queue.Poll(msg) && msg.type == MessageType::BOOTCOMPLETETYPE;
+        delay(1);
+    }
+    TEST_ASSERT_TRUE(booted);
+}
+
+void test_configure_refuses_what_the_transport_cannot_write()
+{
+    CommandRequest request = fullConfiguration();
+    unsigned long requests = simSensor.getStats().requests;
+    bool fits = ZforceBase::ConfigurationLength(CONFIG_ALL) <= zforce.MaxWrite();
+
+    TEST_ASSERT_EQUAL(40, ZforceBase::ConfigurationLength(CONFIG_ALL));
+    TEST_ASSERT_EQUAL(fits, zforce.Configure(request.configuration));
+    TEST_ASSERT_EQUAL(fits ? 1 : 0, simSensor.getStats().requests - requests);
+
+    MessageVariant msg;
+    for (uint8_t i = 0; i < 10; i++) // the response, if any, is dropped as stray
+    {
+        queue.Poll(msg);
+        delay(1);
+    }
+}
+
+void test_full_configuration_completes_merged()
+{
+    unsigned long requests = simSensor.getStats().requests;
+    bool fits = ZforceBase::ConfigurationLength(CONFIG_ALL) <= zforce.MaxWrite();
+
+    TEST_ASSERT_TRUE(queue.Submit(fullConfiguration(), done) != COMMAND_INVALID_HANDLE);
+    runQueue();
+
+    TEST_ASSERT_EQUAL(CommandStatus::DONE, lastStatus);
+    TEST_ASSERT_EQUAL(fits ? 1 : 2, simSensor.getStats().requests - requests);
+    TEST_ASSERT_EQUAL(MessageType::DEVICECONFIGURATIONTYPE, lastResponse.type);
+    const DeviceConfiguration &config = lastResponse.configuration;
+    TEST_ASSERT_EQUAL(CONFIG_ALL, config.fields);
+    TEST_ASSERT_EQUAL(100, config.touchActiveArea.minX);
+    TEST_ASSERT_EQUAL(200, config.touchActiveArea.minY);
+    TEST_ASSERT_EQUAL(3000, config.touchActiveArea.maxX);
+    TEST_ASSERT_EQUAL(4000, config.touchActiveArea.maxY);
+    TEST_ASSERT_TRUE(config.reverseX);
+    TEST_ASSERT_FALSE(config.reverseY);
+    TEST_ASSERT_TRUE(config.flipXY);
+    TEST_ASSERT_EQUAL(5, config.reportedTouches);
+    TEST_ASSERT_EQUAL(1, queue.Stats(MessageType::DEVICECONFIGURATIONTYPE).completed);
+}
+
+void test_single_setting_answered_with_full_configuration()
+{
+    CommandRequest request;
+    request.type = MessageType::REPORTEDTOUCHESTYPE;
+    request.reportedTouches = 3;
+
+    simSensor.setFullConfigurationReplies(true);
+    TEST_ASSERT_TRUE(queue.Submit(request, done) != COMMAND_INVALID_HANDLE);
+    runQueue();
+    simSensor.setFullConfigurationReplies(false);
+
+    TEST_ASSERT_EQUAL(CommandStatus::DONE, lastStatus);
+    TEST_ASSERT_EQUAL(MessageType::REPORTEDTOUCHESTYPE, lastResponse.type);
+    TEST_ASSERT_EQUAL(3, lastResponse.reportedTouches);
+}
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start);
+    RUN_TEST(test_configure_refuses_what_the_transport_cannot_write);
+    RUN_TEST(test_full_configuration_completes_merged);
+    RUN_TEST(test_single_setting_answered_with_full_configuration);
+    exit(UNITY_END());
+}
+
+void loop() {}
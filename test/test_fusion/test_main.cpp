@@ -0,0 +1,171 @@
+/*  Touches of several sensors fused into one surface
+
+    A finger in the overlap of two sensors has to come out as one touch
+    that lives as long as either sensor sees it; everything else keeps its
+    own logical id. A sensor's frame only carries the touches it saw.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include "TouchFusion.h"
+
+static TouchFusion fusion;
+static TouchFrame out;
+
+void setUp()
+{
+    fusion = TouchFusion();
+    fusion.setTransform(1, TouchFusion::makeTransform(1000, 0, 0)); // 1000 to the right of sensor 0
+}
+void tearDown() {}
+
+static TouchFrame frame(uint8_t id, TouchEvent event, uint16_t x, uint16_t y)
+{
+    TouchFrame in;
+    in.touchCount = 1;
+    in.touchData[0] = {x, y, id, event};
+    return in;
+}
+
+static TouchFrame noTouches()
+{
+    TouchFrame in;
+    in.touchCount = 0;
+    return in;
+}
+
+void test_overlap_merges_into_one_touch()
+{
+    TEST_ASSERT_EQUAL(1, fusion.fuse(0, frame(0, DOWN, 1500, 100), out));
+    TEST_ASSERT_EQUAL(0, out.touchData[0].id);
+    TEST_ASSERT_EQUAL(DOWN, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(1500, out.touchData[0].x);
+
+    // Sensor 1 sees the same finger at 520 + 1000: one touch at the average.
+    TEST_ASSERT_EQUAL(1, fusion.fuse(1, frame(5, DOWN, 520, 110), out));
+    TEST_ASSERT_EQUAL(0, out.touchData[0].id);
+    TEST_ASSERT_EQUAL(MOVE, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(1510, out.touchData[0].x);
+    TEST_ASSERT_EQUAL(105, out.touchData[0].y);
+    TEST_ASSERT_EQUAL(1, fusion.getStats().merges);
+}
+
+void test_touch_lasts_while_any_sensor_sees_it()
+{
+    fusion.fuse(0, frame(0, DOWN, 1500, 100), out);
+    fusion.fuse(1, frame(5, DOWN, 520, 110), out);
+
+    // Sensor 0 lifts; sensor 1 still sees the finger.
+    TEST_ASSERT_EQUAL(1, fusion.fuse(0, frame(0, UP, 1500, 100), out));
+    TEST_ASSERT_EQUAL(MOVE, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(1520, out.touchData[0].x);
+
+    TEST_ASSERT_EQUAL(1, fusion.fuse(1, frame(5, UP, 520, 110), out));
+    TEST_ASSERT_EQUAL(0, out.touchData[0].id);
+    TEST_ASSERT_EQUAL(UP, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(0, fusion.fuse(1, noTouches(), out));
+}
+
+void test_far_touches_stay_apart()
+{
+    fusion.fuse(0, frame(0, DOWN, 1500, 100), out);
+    TEST_ASSERT_EQUAL(1, fusion.fuse(1, frame(5, DOWN, 2000, 100), out));
+    TEST_ASSERT_EQUAL(1, out.touchData[0].id);
+    TEST_ASSERT_EQUAL(DOWN, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(3000, out.touchData[0].x);
+    TEST_ASSERT_EQUAL(0, fusion.getStats().merges);
+}
+
+void test_other_sensors_touches_are_not_repeated()
+{
+    fusion.fuse(0, frame(0, DOWN, 100, 100), out);
+    fusion.fuse(1, frame(5, DOWN, 2000, 100), out);
+
+    // Sensor 1's frames only carry its own finger; sensor 0's has not moved.
+    TEST_ASSERT_EQUAL(1, fusion.fuse(1, frame(5, MOVE, 2010, 100), out));
+    TEST_ASSERT_EQUAL(1, out.touchData[0].id);
+    TEST_ASSERT_EQUAL(MOVE, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(3010, out.touchData[0].x);
+    TEST_ASSERT_EQUAL(1, fusion.fuse(1, noTouches(), out)); // only sensor 1's UP
+    TEST_ASSERT_EQUAL(1, out.touchData[0].id);
+    TEST_ASSERT_EQUAL(UP, out.touchData[0].event);
+
+    TEST_ASSERT_EQUAL(1, fusion.fuse(0, frame(0, MOVE, 110, 100), out));
+    TEST_ASSERT_EQUAL(0, out.touchData[0].id);
+}
+
+void test_missing_touch_goes_up()
+{
+    fusion.fuse(0, frame(3, DOWN, 10, 10), out);
+    TEST_ASSERT_EQUAL(1, fusion.fuse(0, noTouches(), out));
+    TEST_ASSERT_EQUAL(UP, out.touchData[0].event);
+    TEST_ASSERT_EQUAL(0, fusion.fuse(0, noTouches(), out));
+}
+
+void test_rotation_and_scale()
+{
+    fusion.setTransform(2, TouchFusion::makeTransform(0, 0, 90));
+    fusion.setTransform(3, TouchFusion::makeTransform(0, 0, 0, FUSION_ONE * 2));
+
+    fusion.fuse(2, frame(1, DOWN, 100, 0), out);
+    TEST_ASSERT_EQUAL(0, out.touchData[0].x);
+    TEST_ASSERT_EQUAL(100, out.touchData[0].y);
+
+    fusion.fuse(3, frame(1, DOWN, 30000, 30000), out);
+    TEST_ASSERT_EQUAL(1, out.touchCount);
+    TEST_ASSERT_EQUAL(60000, out.touchData[0].x);
+    TEST_ASSERT_EQUAL(60000, out.touchData[0].y);
+}
+
+void test_scale_is_clamped()
+{
+    SensorTransform transform = TouchFusion::makeTransform(0, 0, 0, FUSION_ONE * 16);
+    TEST_ASSERT_EQUAL(FUSION_MAX_SCALE, transform.m[0]);
+    TEST_ASSERT_EQUAL(FUSION_MAX_SCALE, transform.m[3]);
+    transform = TouchFusion::makeTransform(0, 0, 180, FUSION_ONE * 16);
+    TEST_ASSERT_EQUAL(-FUSION_MAX_SCALE, transform.m[0]);
+}
+
+void test_full_table_overflows()
+{
+    TouchFrame in;
+    in.touchCount = MAX_REPORTED_TOUCHES;
+    for (uint8_t i = 0; i < MAX_REPORTED_TOUCHES; i++)
+        in.touchData[i] = {(uint16_t)(i * 300), 5000, i, DOWN};
+    TEST_ASSERT_EQUAL(MAX_REPORTED_TOUCHES, fusion.fuse(0, in, out));
+
+    for (uint8_t i = 0; i < MAX_REPORTED_TOUCHES; i++)
+        in.touchData[i].y = 40000;
+    fusion.fuse(1, in, out);
+    TEST_ASSERT_EQUAL(MAX_REPORTED_TOUCHES, fusion.getStats().overflows);
+}
+
+void test_max_touches_limits_the_fused_frame()
+{
+    TouchFusion limited(4);
+    TouchFrame in;
+    in.touchCount = 6;
+    for (uint8_t i = 0; i < 6; i++)
+        in.touchData[i] = {(uint16_t)(i * 300), 5000, i, DOWN};
+
+    TEST_ASSERT_EQUAL(4, limited.fuse(0, in, out));
+    TEST_ASSERT_EQUAL(2, limited.getStats().overflows);
+    for (uint8_t i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL(i, out.touchData[i].id);
+}
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_overlap_merges_into_one_touch);
+    RUN_TEST(test_touch_lasts_while_any_sensor_sees_it);
+    RUN_TEST(test_far_touches_stay_apart);
+    RUN_TEST(test_other_sensors_touches_are_not_repeated);
+    RUN_TEST(test_missing_touch_goes_up);
+    RUN_TEST(test_rotation_and_scale);
+    RUN_TEST(test_scale_is_clamped);
+    RUN_TEST(test_full_table_overflows);
+    RUN_TEST(test_max_touches_limits_the_fused_frame);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,102 @@
+/*  No heap use while touches stream
+
+    Reading frames with GetMessage(MessageVariant&) and everything the
+    sketch's loop() calls must not allocate; see HostHeap.cpp.
+*/
+#include <Arduino.h>
+#include <HostArduino.h>
+#include <SimZforce.h>
+#include <unity.h>
+#include "SensorHelper.h"
+
+void setUp() {}
+void tearDown() {}
+
+static bool waitForMessage(MessageVariant &msg, unsigned long timeout = 100)
+{
+    unsigned long start = millis();
+    while (millis() - start < timeout)
+    {
+        if (zforce.GetMessage(msg)) // checks data ready itself, or reads from its edge with DMA
+            return true;
+        delay(1);
+    }
+    return false;
+}
+
+void test_get_message_does_not_allocate()
+{
+    MessageVariant msg;
+    zforce.Start(PIN_NN_DR);
+    TEST_ASSERT_TRUE(waitForMessage(msg));
+    TEST_ASSERT_EQUAL(MessageType::BOOTCOMPLETETYPE, msg.type);
+    TEST_ASSERT_TRUE(zforce.Enable(true));
+    do
+        TEST_ASSERT_TRUE(waitForMessage(msg));
+    while (msg.type != MessageType::ENABLETYPE);
+
+    unsigned long before = HostArduino::allocations();
+    uint16_t touchFrames = 0;
+    for (uint16_t i = 0; i < 100; i++)
+    {
+        TEST_ASSERT_TRUE(waitForMessage(msg));
+        touchFrames += msg.type == MessageType::TOUCHTYPE;
+    }
+    TEST_ASSERT_EQUAL(100, touchFrames);
+    TEST_ASSERT_EQUAL(0, HostArduino::allocations() - before);
+}
+
+// What src/main.cpp does per loop(), in both serial protocols.
+static void runLoop(unsigned long ms)
+{
+    unsigned long start = millis();
+    while (millis() - start < ms)
+    {
+        if (SensorHelper::updateTouch() > 0)
+        {
+            bool up = SensorHelper::readReg(SensorHelper::reg_R_ChangedSlots) & ~SensorHelper::readReg(SensorHelper::reg_R_ActiveSlots);
+            if (SensorHelper::getSerialProtocol() == SensorHelper::SerialProtocol::BINARY)
+            {
+                SensorHelper::queueTouchFrame();
+                if (up)
+                    SensorHelper::queueRegs();
+            }
+            else
+            {
+                SensorHelper::printTouchMessage();
+                if (up)
+                    SensorHelper::printRegs();
+            }
+        }
+        SensorHelper::pollSerial();
+        HostArduino::service();
+    }
+}
+
+void test_loop_does_not_allocate()
+{
+    SensorHelper::begin();
+    SensorHelper::config();
+    SensorHelper::resetSensorStats();
+
+    // The host's receive buffer allocates, so the command goes in first.
+    HostArduino::serialInject("2,R\n", 4);
+    unsigned long before = HostArduino::allocations();
+    runLoop(500);
+    SensorHelper::setSerialProtocol(SensorHelper::SerialProtocol::BINARY);
+    runLoop(500);
+    TEST_ASSERT_EQUAL(0, HostArduino::allocations() - before);
+    TEST_ASSERT_GREATER_THAN(50, SensorHelper::sensorStats(0).registerFrames);
+}
+
+void setup()
+{
+    simSensor.setFingers(3);
+    simSensor.setStrokeLength(10);
+    UNITY_BEGIN();
+    RUN_TEST(test_get_message_does_not_allocate);
+    RUN_TEST(test_loop_does_not_allocate);
+    exit(UNITY_END());
+}
+
+void loop() {}
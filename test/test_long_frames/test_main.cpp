@@ -0,0 +1,134 @@
+/*  Frames with the most touches
+
+    Ten fingers make a 120 byte touch frame, far longer than the 32 byte
+    Wire buffer of the AVR core, so in native_wire32 every frame is read in
+    chunks. Every frame has to arrive whole and decode to the touches the
+    simulator sent, in both read modes.
+*/
+#include <Arduino.h>
+#include <HostArduino.h>
+#include <SimZforce.h>
+#include <unity.h>
+#include "Zforce.h"
+
+#define FINGERS 10
+#define STROKE 20
+#define AREA 4000
+#define RATE 50 // Hz; a 120 byte frame takes some 12 ms at 100 kHz
+
+void setUp() {}
+void tearDown() {}
+
+static bool waitForMessage(MessageVariant &msg, unsigned long timeout = 100)
+{
+    unsigned long start = millis();
+    while (millis() - start < timeout)
+    {
+        if (zforce.GetMessage(msg))
+            return true;
+        delay(1);
+    }
+    return false;
+}
+
+static bool waitFor(MessageType type)
+{
+    MessageVariant msg;
+    while (waitForMessage(msg))
+    {
+        if (msg.type == type)
+            return true;
+    }
+    return false;
+}
+
+// The touches of the simulator, see SimZforce::queueTouchNotification().
+static void checkTouchFrame(const MessageVariant &msg)
+{
+    TEST_ASSERT_EQUAL(MessageType::TOUCHTYPE, msg.type);
+    TEST_ASSERT_EQUAL(FINGERS, msg.touch.touchCount);
+    for (uint8_t i = 0; i < FINGERS; i++)
+    {
+        const TouchData &touch = msg.touch.touchData[i];
+        TEST_ASSERT_EQUAL(i, touch.id);
+        TEST_ASSERT_EQUAL((uint32_t)AREA * (i + 1) / (FINGERS + 1), touch.x);
+        TEST_ASSERT_EQUAL(touch.y, msg.touch.touchData[0].y);
+        TEST_ASSERT_EQUAL(0, touch.y % (AREA / STROKE));
+        TEST_ASSERT_LESS_OR_EQUAL(AREA, touch.y);
+    }
+}
+
+void test_start()
+{
+    zforce.Start(PIN_NN_DR);
+    TEST_ASSERT_TRUE(waitFor(MessageType::BOOTCOMPLETETYPE));
+    simSensor.setFingers(FINGERS);
+    simSensor.setStrokeLength(STROKE);
+    simSensor.setTouchRate(RATE);
+    TEST_ASSERT_TRUE(zforce.TouchActiveArea(0, 0, AREA, AREA));
+    TEST_ASSERT_TRUE(waitFor(MessageType::TOUCHACTIVEAREATYPE));
+    TEST_ASSERT_TRUE(zforce.ReportedTouches(FINGERS));
+    TEST_ASSERT_TRUE(waitFor(MessageType::REPORTEDTOUCHESTYPE));
+    TEST_ASSERT_TRUE(zforce.Enable(true));
+    TEST_ASSERT_TRUE(waitFor(MessageType::ENABLETYPE));
+}
+
+static void replay(ReadMode mode)
+{
+    MessageVariant msg;
+    zforce.SetReadMode(mode);
+    unsigned long dropped = simSensor.getStats().droppedNotifications;
+    TEST_ASSERT_TRUE(waitForMessage(msg));
+    checkTouchFrame(msg);
+    uint16_t step = msg.touch.touchData[0].y / (AREA / STROKE);
+    for (uint8_t i = 0; i < 3 * STROKE; i++)
+    {
+        TEST_ASSERT_TRUE(waitForMessage(msg));
+        checkTouchFrame(msg);
+        // Strokes go from step 0 to STROKE, so a frame lost to a bad read shows as a gap.
+        step = (step + 1) % (STROKE + 1);
+        TEST_ASSERT_EQUAL(step, msg.touch.touchData[0].y / (AREA / STROKE));
+    }
+    TEST_ASSERT_EQUAL(dropped, simSensor.getStats().droppedNotifications);
+}
+
+void test_header_first_reads_whole_frames()
+{
+    replay(ReadMode::HEADER_FIRST);
+}
+
+void test_single_transaction_reads_whole_frames()
+{
+    replay(ReadMode::SINGLE_TRANSACTION);
+}
+
+#if !ZFORCE_SERCOM_DMA
+// The status of every read, which GetMessage() does not pass on.
+void test_reads_are_not_truncated()
+{
+    uint8_t payload[MAX_PAYLOAD];
+    for (uint8_t i = 0; i < STROKE; i++)
+    {
+        unsigned long start = millis();
+        while (zforce.GetDataReady() == LOW && millis() - start < 100)
+            delay(1);
+        TEST_ASSERT_EQUAL(HIGH, zforce.GetDataReady());
+        TEST_ASSERT_EQUAL(0, zforce.Read(payload));
+        TEST_ASSERT_EQUAL(2 + 4 + 2 + FINGERS * 11, payload[1]); // F0, address, A0 and the touches
+    }
+}
+#endif
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start);
+    RUN_TEST(test_header_first_reads_whole_frames);
+    RUN_TEST(test_single_transaction_reads_whole_frames);
+#if !ZFORCE_SERCOM_DMA
+    RUN_TEST(test_reads_are_not_truncated);
+#endif
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,86 @@
+/*  Register dumps larger than the TX queue
+
+    queueRegs() queues as many READ replies as the DIAGNOSTIC queue takes
+    and pollSerial() queues the rest as the port drains it, so every dump
+    reaches the host whole even with the 128 byte queues of the AVR.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include "SensorHelper.h"
+
+using namespace SensorHelper;
+
+// A port that takes a few bytes per poll and decodes the frames it is sent.
+class SlowPort : public Stream
+{
+public:
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() override { return 8; }
+    size_t write(uint8_t c) override
+    {
+        if (!reader.feed(c))
+            return 1;
+        const uint8_t *payload = reader.payload();
+        if (payload[0] == ((uint8_t)FrameCommand::READ | (uint8_t)FrameCommand::REPLY))
+        {
+            inOrder = inOrder && payload[1] == next % regCount;
+            next += payload[2];
+        }
+        return 1;
+    }
+    using Print::write;
+
+    FrameReader reader;
+    unsigned long next = 0; // registers received, over all dumps
+    bool inOrder = true;    // every reply starts where the one before ended
+};
+
+void setUp()
+{
+    txQueue.clear();
+    txQueue.resetStats();
+}
+void tearDown() {}
+
+static void pollUntilSent(SlowPort &port)
+{
+    for (uint16_t i = 0; i < 1000 && !(queuePendingRegs() && txQueue.empty()); i++)
+        pollSerial(port);
+}
+
+void test_dump_goes_out_whole()
+{
+    SlowPort port;
+    queueRegs();
+    pollUntilSent(port);
+    TEST_ASSERT_TRUE(port.inOrder);
+    TEST_ASSERT_EQUAL(regCount, port.next);
+    TEST_ASSERT_EQUAL(0, txQueue.getStats(TxPriority::DIAGNOSTIC).dropped);
+}
+
+void test_dumps_back_to_back()
+{
+    SlowPort port;
+    queueRegs();
+    queueRegs(); // waits for the first if the queue is full
+    pollUntilSent(port);
+    queueRegs();
+    pollUntilSent(port);
+    TEST_ASSERT_EQUAL(0, txQueue.getStats(TxPriority::DIAGNOSTIC).dropped);
+    TEST_ASSERT_TRUE(port.inOrder);
+    TEST_ASSERT_EQUAL(0, port.next % regCount);
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * regCount, port.next);
+}
+
+void setup()
+{
+    setSerialProtocol(SerialProtocol::BINARY);
+    UNITY_BEGIN();
+    RUN_TEST(test_dump_goes_out_whole);
+    RUN_TEST(test_dumps_back_to_back);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,61 @@
+/*  Register commands of the serial text protocol
+
+    "addr,W,val" prints and returns what the register holds afterwards, so
+    a write the register table rejects does not look like it took.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include "SensorHelper.h"
+
+using namespace SensorHelper;
+
+static char command[16];
+
+// The dead band registers move with TOUCH_SLOTS.
+static const char *deadBandX(const char *rest)
+{
+    snprintf(command, sizeof(command), "%u,%s", reg_RW_DeadBandX, rest);
+    return command;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_write_is_echoed()
+{
+    SensorReg_t reg = runCommand(deadBandX("W,7"));
+    TEST_ASSERT_EQUAL(reg_RW_DeadBandX, reg.addr);
+    TEST_ASSERT_EQUAL(7, reg.val);
+    TEST_ASSERT_EQUAL(7, readReg(reg_RW_DeadBandX));
+}
+
+void test_rejected_write_returns_the_stored_value()
+{
+    sensor_val_t before = readReg(reg_RW_Enable);
+    SensorReg_t reg = runCommand("2,W,5"); // Enable takes 0 or 1
+    TEST_ASSERT_EQUAL(reg_RW_Enable, reg.addr);
+    TEST_ASSERT_EQUAL(before, reg.val);
+    TEST_ASSERT_EQUAL(before, readReg(reg_RW_Enable));
+
+    reg = runCommand("0,W,1"); // read only
+    TEST_ASSERT_EQUAL(readReg(reg_R_Status), reg.val);
+}
+
+void test_read()
+{
+    SensorReg_t reg = runCommand(deadBandX("R"));
+    TEST_ASSERT_EQUAL(readReg(reg_RW_DeadBandX), reg.val);
+    reg = runCommand("255,R");
+    TEST_ASSERT_EQUAL(0, reg.val);
+}
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_write_is_echoed);
+    RUN_TEST(test_rejected_write_returns_the_stored_value);
+    RUN_TEST(test_read);
+    exit(UNITY_END());
+}
+
+void loop() {}
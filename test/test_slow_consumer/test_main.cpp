@@ -0,0 +1,147 @@
+/*  Touch events with a consumer slower than the sensor
+
+    Frames arrive at 100 Hz and are taken from the touch ring only every
+    CONSUME_PERIOD ms. COALESCE and LATEST merge frames instead of dropping
+    them, so every DOWN still reaches the consumer with its UP; DROP_OLDEST
+    loses frames, but has to count every DOWN and UP it loses.
+*/
+#include <Arduino.h>
+#include <HostArduino.h>
+#include <SimZforce.h>
+#include <unity.h>
+#include "SensorHelper.h"
+
+#define CONSUME_PERIOD 40 // ms
+#define RUN_TIME 2000     // ms
+#define FINGERS 3
+
+typedef struct Events
+{
+    unsigned long downs;
+    unsigned long ups;
+    unsigned long anomalies; // a DOWN of a touch that is down, or an UP of one that is not
+} Events;
+
+static bool down[256];
+
+void setUp() {}
+void tearDown() {}
+
+static bool anyDown()
+{
+    for (uint16_t id = 0; id < 256; id++)
+    {
+        if (down[id])
+            return true;
+    }
+    return false;
+}
+
+static bool consume(Events &events)
+{
+    TouchRecord record;
+    if (!SensorHelper::touchRing.pop(record))
+        return false;
+    for (uint8_t i = 0; i < record.frame.touchCount; i++)
+    {
+        const TouchData &touch = record.frame.touchData[i];
+        if (touch.event == DOWN)
+        {
+            events.anomalies += down[touch.id];
+            down[touch.id] = true;
+            events.downs++;
+        }
+        else if (touch.event == UP)
+        {
+            events.anomalies += !down[touch.id];
+            down[touch.id] = false;
+            events.ups++;
+        }
+    }
+    return true;
+}
+
+// Consumes slowly for RUN_TIME, then at full speed until every touch is up again.
+static Events run(RingPolicy policy)
+{
+    Events events = {0, 0, 0};
+    SensorHelper::touchRing.setPolicy(policy);
+    SensorHelper::touchRing.resetStats();
+
+    unsigned long start = millis();
+    unsigned long nextConsume = start;
+    while (millis() - start < RUN_TIME)
+    {
+        SensorHelper::pollSensors();
+        if ((long)(millis() - nextConsume) >= 0)
+        {
+            nextConsume += CONSUME_PERIOD;
+            consume(events);
+        }
+        delay(1);
+    }
+
+    start = millis();
+    while (anyDown() && millis() - start < 500)
+    {
+        SensorHelper::pollSensors();
+        consume(events);
+        delay(1);
+    }
+    return events;
+}
+
+void test_start()
+{
+    simSensor.setFingers(FINGERS);
+    SensorHelper::begin();
+    SensorHelper::config();
+    Events events = run(RingPolicy::COALESCE); // until the first strokes are through
+    TEST_ASSERT_GREATER_THAN(0, events.downs);
+}
+
+static void checkKeepsEvents(RingPolicy policy)
+{
+    Events events = run(policy);
+    const TouchRingStats &stats = SensorHelper::touchRing.getStats();
+
+    TEST_ASSERT_GREATER_THAN(0, stats.coalesced); // the consumer did fall behind
+    TEST_ASSERT_EQUAL(0, stats.dropped);
+    TEST_ASSERT_EQUAL(0, stats.lostEvents);
+    TEST_ASSERT_GREATER_THAN(RUN_TIME / 250, events.downs);
+    TEST_ASSERT_EQUAL(events.downs, events.ups);
+    TEST_ASSERT_EQUAL(0, events.anomalies);
+    TEST_ASSERT_FALSE(anyDown());
+}
+
+void test_coalesce_keeps_every_down_and_up()
+{
+    checkKeepsEvents(RingPolicy::COALESCE);
+}
+
+void test_latest_keeps_every_down_and_up()
+{
+    checkKeepsEvents(RingPolicy::LATEST);
+}
+
+void test_drop_oldest_counts_what_it_loses()
+{
+    Events events = run(RingPolicy::DROP_OLDEST);
+    const TouchRingStats &stats = SensorHelper::touchRing.getStats();
+
+    TEST_ASSERT_GREATER_THAN(0, stats.dropped);
+    unsigned long unmatched = events.downs > events.ups ? events.downs - events.ups : events.ups - events.downs;
+    TEST_ASSERT_LESS_OR_EQUAL(stats.lostEvents, unmatched + events.anomalies);
+}
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start);
+    RUN_TEST(test_coalesce_keeps_every_down_and_up);
+    RUN_TEST(test_latest_keeps_every_down_and_up);
+    RUN_TEST(test_drop_oldest_counts_what_it_loses);
+    exit(UNITY_END());
+}
+
+void loop() {}
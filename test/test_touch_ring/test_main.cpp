@@ -0,0 +1,106 @@
+/*  Touch ring policies
+
+    LATEST merges a frame into the newest queued one as soon as one waits
+    behind the frame due next; COALESCE only once the ring is full and
+    DROP_OLDEST never.
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include "TouchRing.h"
+
+static TouchRing<4> ring;
+static TouchRecord record;
+
+void setUp()
+{
+    ring.clear();
+    ring.resetStats();
+}
+void tearDown() {}
+
+static TouchFrame frame(uint8_t id, TouchEvent event, uint16_t x)
+{
+    TouchFrame touches;
+    touches.touchCount = 1;
+    touches.touchData[0] = {x, 100, id, event};
+    return touches;
+}
+
+static void push(uint8_t id, TouchEvent event, uint16_t x)
+{
+    ring.push(0, frame(id, event, x), micros());
+}
+
+void test_latest_merges_moves_behind_the_next_frame()
+{
+    ring.setPolicy(RingPolicy::LATEST);
+    for (uint16_t x = 1; x <= 10; x++)
+        push(0, MOVE, x);
+
+    TEST_ASSERT_EQUAL(2, ring.level());
+    TEST_ASSERT_EQUAL(2, ring.getStats().maxLevel);
+    TEST_ASSERT_EQUAL(8, ring.getStats().coalesced);
+    TEST_ASSERT_EQUAL(8, ring.getStats().mergedMoves);
+
+    TEST_ASSERT_TRUE(ring.pop(record));
+    TEST_ASSERT_EQUAL(1, record.frame.touchData[0].x);
+    TEST_ASSERT_TRUE(ring.pop(record));
+    TEST_ASSERT_EQUAL(1, record.frame.touchCount);
+    TEST_ASSERT_EQUAL(10, record.frame.touchData[0].x); // the latest position
+    TEST_ASSERT_FALSE(ring.pop(record));
+}
+
+void test_latest_keeps_down_and_up()
+{
+    ring.setPolicy(RingPolicy::LATEST);
+    push(0, MOVE, 1);
+    push(1, DOWN, 2);
+    push(1, MOVE, 3);
+    push(1, UP, 4);
+
+    TEST_ASSERT_EQUAL(2, ring.level());
+    TEST_ASSERT_TRUE(ring.pop(record));
+    TEST_ASSERT_TRUE(ring.pop(record));
+    TEST_ASSERT_EQUAL(2, record.frame.touchCount);
+    TEST_ASSERT_EQUAL(DOWN, record.frame.touchData[0].event); // a DOWN stays a DOWN, at the new position
+    TEST_ASSERT_EQUAL(3, record.frame.touchData[0].x);
+    TEST_ASSERT_EQUAL(UP, record.frame.touchData[1].event);
+    TEST_ASSERT_EQUAL(4, record.frame.touchData[1].x);
+}
+
+void test_coalesce_merges_only_when_full()
+{
+    ring.setPolicy(RingPolicy::COALESCE);
+    for (uint16_t x = 1; x <= 6; x++)
+        push(0, MOVE, x);
+
+    TEST_ASSERT_EQUAL(4, ring.level());
+    TEST_ASSERT_EQUAL(2, ring.getStats().coalesced);
+    TEST_ASSERT_EQUAL(0, ring.getStats().dropped);
+}
+
+void test_drop_oldest_counts_lost_events()
+{
+    ring.setPolicy(RingPolicy::DROP_OLDEST);
+    push(0, DOWN, 1);
+    for (uint16_t x = 2; x <= 5; x++)
+        push(0, MOVE, x);
+
+    TEST_ASSERT_EQUAL(4, ring.level());
+    TEST_ASSERT_EQUAL(1, ring.getStats().dropped);
+    TEST_ASSERT_EQUAL(1, ring.getStats().lostEvents);
+    TEST_ASSERT_TRUE(ring.pop(record));
+    TEST_ASSERT_EQUAL(2, record.frame.touchData[0].x);
+}
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_latest_merges_moves_behind_the_next_frame);
+    RUN_TEST(test_latest_keeps_down_and_up);
+    RUN_TEST(test_coalesce_merges_only_when_full);
+    RUN_TEST(test_drop_oldest_counts_lost_events);
+    exit(UNITY_END());
+}
+
+void loop() {}